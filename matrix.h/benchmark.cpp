@@ -0,0 +1,503 @@
+// Benchmark and tuning harness for matrix.h.
+//
+//   matrix_benchmark [--fields double,rational,residue,biginteger]
+//                    [--ops multiply,det,rank,inverse,transpose] [--sizes 16,32,64]
+//                    [--repeat 3] [--format csv|json] [--output file] [--perf]
+//   matrix_benchmark --tune [header]
+//
+// The ops charpoly, berkowitz, interpolate and eigenvalues are not run by default. They
+// compare charpoly() (Hessenberg for fields, Berkowitz for BigInteger and Rational),
+// Berkowitz on every field, det(xI - A) at n + 1 points with interpolation, and QR
+// eigenvalues for double.
+//
+// Every run reports the best time over the repeats, the heap allocations of one run
+// (counted by the operator new below), GFLOP/s from the textbook operation counts
+// (field operations for the exact fields) and, with --perf on Linux, cycles,
+// instructions and cache misses from perf_event. --tune measures the Strassen and
+// transpose thresholds and writes them to matrix_tuning.h next to matrix.h, where the
+// next build picks them up.
+#include "matrix.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <random>
+#include <sstream>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+#ifndef MATRIX_SOURCE_DIR
+#define MATRIX_SOURCE_DIR "."
+#endif
+
+// The replacement operator new below pairs malloc with free; GCC cannot see through it.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+std::atomic<unsigned long long> allocation_count(0);
+std::atomic<unsigned long long> allocation_bytes(0);
+
+void* operator new(size_t size) {
+    ++allocation_count;
+    allocation_bytes += size;
+    if (void* p = std::malloc(size == 0 ? 1 : size))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+// Hardware counters of the calling thread; all zero when perf_event is unavailable
+// (other systems, containers, or perf_event_paranoid forbidding it).
+class PerfCounters {
+private:
+    static const unsigned count = 3;
+    int fds[count] = {-1, -1, -1};
+public:
+    unsigned long long values[count] = {0, 0, 0};
+
+    explicit PerfCounters(bool enabled) {
+#ifdef __linux__
+        if (!enabled)
+            return;
+        const unsigned long long configs[count] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                                   PERF_COUNT_HW_CACHE_MISSES};
+        for (unsigned i = 0; i < count; ++i) {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.size = sizeof(attr);
+            attr.config = configs[i];
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            fds[i] = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+        }
+#else
+        (void)enabled;
+#endif
+    }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    ~PerfCounters() {
+#ifdef __linux__
+        for (int fd : fds) {
+            if (fd >= 0)
+                close(fd);
+        }
+#endif
+    }
+
+    bool available() const {
+        return fds[0] >= 0;
+    }
+
+    void start() {
+#ifdef __linux__
+        for (int fd : fds) {
+            if (fd >= 0) {
+                ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+#endif
+    }
+
+    void stop() {
+#ifdef __linux__
+        for (unsigned i = 0; i < count; ++i) {
+            values[i] = 0;
+            if (fds[i] < 0)
+                continue;
+            ioctl(fds[i], PERF_EVENT_IOC_DISABLE, 0);
+            if (read(fds[i], &values[i], sizeof(values[i])) != sizeof(values[i]))
+                values[i] = 0;
+        }
+#endif
+    }
+};
+
+struct Record {
+    std::string field;
+    std::string op;
+    unsigned n = 0;
+    double seconds = 0;
+    unsigned long long allocations = 0;
+    unsigned long long allocated_bytes = 0;
+    double gflops = 0;
+    bool has_counters = false;
+    unsigned long long cycles = 0;
+    unsigned long long instructions = 0;
+    unsigned long long cache_misses = 0;
+};
+
+struct Options {
+    std::vector<std::string> fields = {"double", "rational", "residue", "biginteger"};
+    std::vector<std::string> ops = {"multiply", "det", "rank", "inverse", "transpose"};
+    std::vector<unsigned> sizes;
+    unsigned repeat = 3;
+    std::string format = "csv";
+    std::string output;
+    bool perf = false;
+    bool tune = false;
+    std::string tuning_header = std::string(MATRIX_SOURCE_DIR) + "/matrix_tuning.h";
+};
+
+std::vector<std::string> split(const std::string& list) {
+    std::vector<std::string> result;
+    std::stringstream in(list);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        if (!item.empty())
+            result.push_back(item);
+    }
+    return result;
+}
+
+bool contains(const std::vector<std::string>& list, const std::string& item) {
+    return std::find(list.begin(), list.end(), item) != list.end();
+}
+
+double seconds_of(const std::function<void()>& run) {
+    auto start = std::chrono::steady_clock::now();
+    run();
+    return seconds_since(start);
+}
+
+// operation counts of the textbook algorithms
+double operation_count(const std::string& op, unsigned n) {
+    double x = n;
+    if (op == "multiply" || op == "inverse")
+        return 2 * x * x * x;
+    if (op == "det" || op == "rank")
+        return 2 * x * x * x / 3;
+    return 0;
+}
+
+Record measure(const std::string& field, const std::string& op, unsigned n, const Options& options,
+               const std::function<void()>& run) {
+    Record record;
+    record.field = field;
+    record.op = op;
+    record.n = n;
+    record.seconds = INFINITY;
+    PerfCounters counters(options.perf);
+    for (unsigned r = 0; r < options.repeat; ++r) {
+        unsigned long long count = allocation_count;
+        unsigned long long bytes = allocation_bytes;
+        counters.start();
+        double seconds = seconds_of(run);
+        counters.stop();
+        if (seconds < record.seconds) {
+            record.seconds = seconds;
+            record.allocations = allocation_count - count;
+            record.allocated_bytes = allocation_bytes - bytes;
+            record.cycles = counters.values[0];
+            record.instructions = counters.values[1];
+            record.cache_misses = counters.values[2];
+        }
+    }
+    record.has_counters = counters.available();
+    record.gflops = operation_count(op, n) / record.seconds / 1e9;
+    return record;
+}
+
+template <typename Field>
+DynamicMatrix<Field> random_matrix(unsigned n, std::mt19937& generator, int range) {
+    DynamicMatrix<Field> a(n, n);
+    for (unsigned i = 0; i < n; ++i) {
+        for (unsigned j = 0; j < n; ++j) {
+            a[i][j] = Field(static_cast<int>(generator() % (2 * range + 1)) - range);
+        }
+    }
+    return a;
+}
+
+template <unsigned P>
+DynamicMatrix<Residue<P>> random_residue_matrix(unsigned n, std::mt19937& generator) {
+    DynamicMatrix<Residue<P>> a(n, n);
+    for (unsigned i = 0; i < n; ++i) {
+        for (unsigned j = 0; j < n; ++j) {
+            a[i][j] = Residue<P>(static_cast<int>(generator() % P));
+        }
+    }
+    return a;
+}
+
+// det(xI - A) at x = 0, ..., n, then Newton interpolation: the baseline for charpoly().
+// Divided differences at consecutive integers only divide by k, and for a polynomial with
+// integer coefficients those divisions are exact, so this also runs over BigInteger.
+template <typename Field>
+polynom<Field> interpolated_charpoly(const DynamicMatrix<Field>& a) {
+    unsigned n = a.rows();
+    std::vector<Field> d(n + 1);
+    for (unsigned x = 0; x <= n; ++x) {
+        DynamicMatrix<Field> shifted = a * Field(-1);
+        for (unsigned i = 0; i < n; ++i) {
+            shifted[i][i] += Field(static_cast<int>(x));
+        }
+        d[x] = shifted.det();
+    }
+    for (unsigned k = 1; k <= n; ++k) {
+        for (unsigned x = n; x >= k; --x) {
+            d[x] = (d[x] - d[x - 1]) / Field(static_cast<int>(k));
+        }
+    }
+    // d[n] (x - n + 1) ... (x - 1) x + ... + d[1] x + d[0], by Horner from the inside
+    polynom<Field> p(1, d[n]);
+    for (unsigned k = n; k-- > 0;) {
+        p.insert(p.begin(), Field(0));
+        for (unsigned j = 0; j + 1 < p.size(); ++j) {
+            p[j] -= p[j + 1] * Field(static_cast<int>(k));
+        }
+        p[0] += d[k];
+    }
+    return p;
+}
+
+template <typename Field>
+std::function<void()> eigenvalues_run(const DynamicMatrix<Field>&) {
+    return nullptr;
+}
+
+std::function<void()> eigenvalues_run(const DynamicMatrix<double>& a) {
+    return [&a]() { eigenvalues(a); };
+}
+
+template <typename Field>
+void run_field(const std::string& field, const DynamicMatrix<Field>& a, const DynamicMatrix<Field>& b,
+               const Options& options, bool is_ring, std::vector<Record>& records) {
+    unsigned n = a.rows();
+    for (const std::string& op : options.ops) {
+        std::function<void()> run;
+        if (op == "multiply") {
+            run = [&a, &b]() { DynamicMatrix<Field> c = a * b; };
+        } else if (op == "det") {
+            run = [&a]() { a.det(); };
+        } else if (op == "rank") {
+            run = [&a]() { a.rank(); };
+        } else if (op == "inverse" && !is_ring) {
+            run = [&a]() { DynamicMatrix<Field> c = a.inverted(); };
+        } else if (op == "transpose") {
+            run = [&a]() { DynamicMatrix<Field> c = a.transposed(); };
+        } else if (op == "charpoly") {
+            run = [&a]() { a.charpoly(); };
+        } else if (op == "berkowitz") {
+            run = [&a, n]() {
+                std::vector<std::vector<Field>> table(n);
+                for (unsigned i = 0; i < n; ++i) {
+                    table[i] = a[i];
+                }
+                berkowitz_kernel(table, n);
+            };
+        } else if (op == "interpolate") {
+            run = [&a]() { interpolated_charpoly(a); };
+        } else if (op == "eigenvalues") {
+            run = eigenvalues_run(a);
+        } else {
+            continue;
+        }
+        if (!run)
+            continue;
+        records.push_back(measure(field, op, n, options, run));
+        std::cerr << field << " " << op << " " << n << ": " << records.back().seconds << " s\n";
+    }
+}
+
+std::vector<unsigned> default_sizes(const std::string& field) {
+    if (field == "rational")
+        return {4, 8, 16, 24};
+    if (field == "biginteger")
+        return {8, 16, 32, 64};
+    return {16, 32, 64, 128, 256, 512};
+}
+
+void write_csv(std::ostream& out, const std::vector<Record>& records) {
+    out << "field,op,n,seconds,allocations,allocated_bytes,gflops,cycles,instructions,cache_misses\n";
+    for (const Record& r : records) {
+        out << r.field << "," << r.op << "," << r.n << "," << r.seconds << "," << r.allocations << ","
+            << r.allocated_bytes << "," << r.gflops << ",";
+        if (r.has_counters)
+            out << r.cycles << "," << r.instructions << "," << r.cache_misses;
+        else
+            out << ",,";
+        out << "\n";
+    }
+}
+
+void write_json(std::ostream& out, const std::vector<Record>& records) {
+    out << "[\n";
+    for (size_t i = 0; i < records.size(); ++i) {
+        const Record& r = records[i];
+        out << "  {\"field\": \"" << r.field << "\", \"op\": \"" << r.op << "\", \"n\": " << r.n
+            << ", \"seconds\": " << r.seconds << ", \"allocations\": " << r.allocations
+            << ", \"allocated_bytes\": " << r.allocated_bytes << ", \"gflops\": " << r.gflops;
+        if (r.has_counters) {
+            out << ", \"cycles\": " << r.cycles << ", \"instructions\": " << r.instructions
+                << ", \"cache_misses\": " << r.cache_misses;
+        }
+        out << "}" << (i + 1 < records.size() ? "," : "") << "\n";
+    }
+    out << "]\n";
+}
+
+double best_of(unsigned repeat, const std::function<void()>& run) {
+    double best = INFINITY;
+    for (unsigned r = 0; r < repeat; ++r) {
+        best = std::min(best, seconds_of(run));
+    }
+    return best;
+}
+
+// Strassen threshold: the smallest size from which Strassen beats the cubic kernel at every
+// measured size. Leaf: the fastest recursion cutoff for a 512 product. Transpose block:
+// the fastest leaf block for a 2048 x 2048 transpose.
+void tune(const Options& options) {
+    std::mt19937 generator(1);
+    auto random_table = [&generator](unsigned n) {
+        std::vector<std::vector<double>> table(n, std::vector<double>(n));
+        for (auto& row : table) {
+            for (double& x : row) {
+                x = std::uniform_real_distribution<double>(-1, 1)(generator);
+            }
+        }
+        return table;
+    };
+
+    unsigned leaf = MATRIX_STRASSEN_LEAF;
+    double best = INFINITY;
+    std::vector<std::vector<double>> a = random_table(512);
+    std::vector<std::vector<double>> b = random_table(512);
+    for (unsigned candidate : {16u, 32u, 64u, 128u, 256u}) {
+        double seconds = best_of(options.repeat, [&]() { strassen_kernel(a, b, 512, 512, 512, candidate); });
+        std::cerr << "strassen leaf " << candidate << ": " << seconds << " s\n";
+        if (seconds < best) {
+            best = seconds;
+            leaf = candidate;
+        }
+    }
+
+    const std::vector<unsigned> sizes = {32, 48, 64, 96, 128, 192, 256, 384, 512};
+    std::vector<bool> strassen_wins;
+    for (unsigned n : sizes) {
+        std::vector<std::vector<double>> x = random_table(n);
+        std::vector<std::vector<double>> y = random_table(n);
+        double cubic = best_of(options.repeat, [&]() { naive_multiply_kernel(x, y, n, n, n); });
+        double strassen = best_of(options.repeat, [&]() { strassen_kernel(x, y, n, n, n, leaf); });
+        std::cerr << "multiply " << n << ": cubic " << cubic << " s, strassen " << strassen << " s\n";
+        strassen_wins.push_back(strassen < cubic);
+    }
+    // the largest size where the cubic kernel still wins; never switch if it wins at the top
+    unsigned threshold = strassen_wins.back() ? sizes.back() : std::numeric_limits<unsigned>::max();
+    for (size_t i = sizes.size(); i-- > 0 && strassen_wins[i];) {
+        threshold = i > 0 ? sizes[i - 1] : 0;
+    }
+
+    unsigned block = MATRIX_TRANSPOSE_BLOCK;
+    best = INFINITY;
+    std::vector<std::vector<double>> source = random_table(2048);
+    std::vector<std::vector<double>> target(2048, std::vector<double>(2048));
+    for (unsigned candidate : {64u, 256u, 1024u, 4096u, 16384u}) {
+        double seconds = best_of(options.repeat, [&]() { transpose_kernel(source, target, 2048, 2048, candidate); });
+        std::cerr << "transpose block " << candidate << ": " << seconds << " s\n";
+        if (seconds < best) {
+            best = seconds;
+            block = candidate;
+        }
+    }
+
+    std::ofstream out(options.tuning_header);
+    out << "// Generated by matrix_benchmark --tune, delete to return to the defaults in matrix.h.\n";
+    // unsigned, so that "never" compares against unsigned sizes without -Wtype-limits warnings
+    out << "#define MATRIX_STRASSEN_THRESHOLD " << threshold << "u\n";
+    out << "#define MATRIX_STRASSEN_LEAF " << leaf << "\n";
+    out << "#define MATRIX_TRANSPOSE_BLOCK " << block << "\n";
+    std::cerr << "wrote " << options.tuning_header << "\n";
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--fields" && has_value) {
+            options.fields = split(argv[++i]);
+        } else if (arg == "--ops" && has_value) {
+            options.ops = split(argv[++i]);
+        } else if (arg == "--sizes" && has_value) {
+            for (const std::string& size : split(argv[++i])) {
+                options.sizes.push_back(std::stoul(size));
+            }
+        } else if (arg == "--repeat" && has_value) {
+            options.repeat = std::max(1ul, std::stoul(argv[++i]));
+        } else if (arg == "--format" && has_value) {
+            options.format = argv[++i];
+        } else if (arg == "--output" && has_value) {
+            options.output = argv[++i];
+        } else if (arg == "--perf") {
+            options.perf = true;
+        } else if (arg == "--tune") {
+            options.tune = true;
+            if (has_value && argv[i + 1][0] != '-')
+                options.tuning_header = argv[++i];
+        } else {
+            std::cerr << "unknown argument " << arg << "\n";
+            return 1;
+        }
+    }
+    if (options.tune) {
+        tune(options);
+        return 0;
+    }
+
+    std::vector<Record> records;
+    std::mt19937 generator(1);
+    for (const std::string& field : options.fields) {
+        std::vector<unsigned> sizes = options.sizes.empty() ? default_sizes(field) : options.sizes;
+        for (unsigned n : sizes) {
+            if (field == "double") {
+                DynamicMatrix<double> a = random_matrix<double>(n, generator, 1000);
+                DynamicMatrix<double> b = random_matrix<double>(n, generator, 1000);
+                run_field("double", a, b, options, false, records);
+            } else if (field == "rational") {
+                DynamicMatrix<Rational> a = random_matrix<Rational>(n, generator, 9);
+                DynamicMatrix<Rational> b = random_matrix<Rational>(n, generator, 9);
+                run_field("rational", a, b, options, false, records);
+            } else if (field == "residue") {
+                DynamicMatrix<Residue<10007>> a = random_residue_matrix<10007>(n, generator);
+                DynamicMatrix<Residue<10007>> b = random_residue_matrix<10007>(n, generator);
+                run_field("residue", a, b, options, false, records);
+            } else if (field == "biginteger") {
+                DynamicMatrix<BigInteger> a = random_matrix<BigInteger>(n, generator, 1000);
+                DynamicMatrix<BigInteger> b = random_matrix<BigInteger>(n, generator, 1000);
+                run_field("biginteger", a, b, options, true, records);
+            } else {
+                std::cerr << "unknown field " << field << "\n";
+                return 1;
+            }
+        }
+    }
+
+    std::ofstream file;
+    if (!options.output.empty())
+        file.open(options.output);
+    std::ostream& out = options.output.empty() ? std::cout : file;
+    if (options.format == "json")
+        write_json(out, records);
+    else
+        write_csv(out, records);
+    return 0;
+}
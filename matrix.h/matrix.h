@@ -5,6 +5,44 @@
 #include <assert.h>
 #include <cmath>
 #include <complex>
+#include <array>
+#include <map>
+#include <set>
+#include <tuple>
+#include <limits>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+#include <chrono>
+#include <future>
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Dispatch thresholds. `matrix_benchmark --tune` measures them on the current machine and
+// writes matrix_tuning.h next to this header; without it the defaults below are used.
+#if defined(__has_include)
+#if __has_include("matrix_tuning.h")
+#include "matrix_tuning.h"
+#endif
+#endif
+// products with a side above this go through Strassen
+#ifndef MATRIX_STRASSEN_THRESHOLD
+#define MATRIX_STRASSEN_THRESHOLD 64
+#endif
+// Strassen recursion switches to the cubic kernel at this size
+#ifndef MATRIX_STRASSEN_LEAF
+#define MATRIX_STRASSEN_LEAF 64
+#endif
+// element count of the leaf blocks of the cache-oblivious transpose
+#ifndef MATRIX_TRANSPOSE_BLOCK
+#define MATRIX_TRANSPOSE_BLOCK 256
+#endif
+
 using complex = std::complex < double >;
 
 template <typename N>
@@ -38,6 +76,7 @@ public:
         isNegative = x.isNegative;
         shrink();
     }
+    BigInteger& operator=(const BigInteger& x) = default;
 
     ~BigInteger() {
         number.clear();
@@ -51,7 +90,7 @@ public:
     }
     BigInteger(const long long x) {
         number.clear();
-        int x_copy = x;
+        long long x_copy = x;
         if (x_copy < 0) {
             isNegative = 1;
             x_copy *= -1;
@@ -402,15 +441,8 @@ BigInteger& BigInteger::operator/=(const BigInteger& a) {
     }
     int n = size();
     BigInteger answer;
+    const BigInteger divisor = a.abs();
 
-    BigInteger coefficient;
-
-    coefficient.resize(n);
-    for (size_t i = 0; i < coefficient.size(); ++i) {
-        coefficient[i] = 0;
-    }
-
-    coefficient.number.back() = 1;
     for (int i = n - 1; i >= 0; --i) {
         BigInteger current;
         for (int j = i; j < n; ++j) {
@@ -418,20 +450,28 @@ BigInteger& BigInteger::operator/=(const BigInteger& a) {
         }
         current.shrink();
 
-        int left =  0;
-        int right = radix;
-        while (right - left > 1) {
-            int middle = (right + left) / 2;
-            if (current >= a * middle) left = middle;
-            else right = middle;
+        // estimate the digit from the leading limbs, it is off by at most one
+        int digit = 0;
+        if (current >= divisor) {
+            long double top = 0;
+            for (size_t j = divisor.size() - 1; j < current.size(); ++j) {
+                top += current[j] * std::pow(static_cast<long double>(radix), j - (divisor.size() - 1));
+            }
+            if (divisor.size() >= 2)
+                top += current[divisor.size() - 2] / static_cast<long double>(radix);
+            long double bottom = divisor[divisor.size() - 1];
+            if (divisor.size() >= 2)
+                bottom += divisor[divisor.size() - 2] / static_cast<long double>(radix);
+            digit = static_cast<int>(std::min<long double>(top / bottom, radix - 1));
+            while (digit > 0 && current < divisor * digit) --digit;
+            while (digit + 1 < radix && current >= divisor * (digit + 1)) ++digit;
         }
-
-        int digit = left;
         answer.push_back(digit);
-        *this -= coefficient * digit * a.abs();
-        if (coefficient.size() != 1) {
-            coefficient.pop_back();
-            coefficient[coefficient.size() - 1] = 1;
+        if (digit != 0) {
+            // divisor * digit * radix^i, shifted by limbs instead of multiplied by radix^i
+            BigInteger product = divisor * digit;
+            product.number.insert(product.number.begin(), i, 0);
+            *this -= product;
         }
     }
     answer.reverse();
@@ -483,15 +523,14 @@ void div2(BigInteger& a) {
 }
 
 void mul2(BigInteger& a) {
+    long long carry = 0;
     for (size_t i = 0; i < a.size(); ++i) {
-        a[i] *= 2;
-        if (a[i] >= BigInteger::radix) {
-            if (i + 1 == a.size()) {
-                a.push_back(0);
-            }
-            a[i + 1] += a[i] / BigInteger::radix;
-            a[i] %= BigInteger::radix;
-        }
+        a[i] = a[i] * 2 + carry;
+        carry = a[i] / BigInteger::radix;
+        a[i] %= BigInteger::radix;
+    }
+    if (carry != 0) {
+        a.push_back(carry);
     }
 }
 
@@ -520,7 +559,7 @@ BigInteger find_gcd(const BigInteger& a1, const BigInteger& b1) {
 class Rational {
     friend bool operator<(const Rational&, const Rational&);
     friend std::ostream& operator<<(std::ostream&,  Rational&);
-    template <typename T> friend bool compare_to_zero(T&);
+    template <typename T> friend bool compare_to_zero(const T&);
 private:
 
 
@@ -554,16 +593,14 @@ public:
         denominator *= a.denominator;
         return *this;
     }
-    Rational& operator*=( Rational& a) {
+    Rational& operator*=(const Rational& a) {
         make_common();
-        a.make_common();
         numerator *= a.numerator;
         denominator *= a.denominator;
         return *this;
     }
-    Rational& operator/=( Rational& a) {
+    Rational& operator/=(const Rational& a) {
         make_common();
-        a.make_common();
         numerator *= a.denominator;
         denominator *= a.numerator.abs();
         if (a.numerator.isNegative && numerator != 0) numerator.isNegative ^= 1;
@@ -692,123 +729,33 @@ Rational operator-(const Rational& a, const Rational& b) {
     x -= b;
     return x;
 }
-Rational operator*( Rational& a,  Rational& b) {
+Rational operator*(const Rational& a, const Rational& b) {
     Rational x = a;
     x *= b;
     return x;
 }
-Rational operator/( Rational& a,  Rational& b) {
+Rational operator/(const Rational& a, const Rational& b) {
     Rational x = a;
     x /= b;
     return x;
 }
 
 
-unsigned euler_function(unsigned N) {
-    if (N == 0) return 0;
-    std::vector < std::pair < unsigned, unsigned > > divisors;
-    unsigned N_copy = N;
-    for (unsigned i = 2; i * i <= N; ++i) {
-        if (N % i == 0) {
-            unsigned cnt = 0;
-            while (N % i == 0) {
-                N /= i;
-                ++cnt;
-            }
-            N_copy /= i;
-            divisors.push_back({i, cnt});
-        }
-    }
-    if (N != 1) {
-        N_copy /= N;
-        divisors.push_back({N, 1});
-    }
-    for (std::pair < unsigned, unsigned > t : divisors)
-        N_copy *= (t.first - 1);
-    return N_copy;
-}
-
-template<bool condition>
-struct compilation_error {
-    static int d[condition ? 1 : -1];
-    ~compilation_error() = default;
-};
-
-
-
-
-template <unsigned N, unsigned S>
-struct is_prime_helping {
-    static const bool value = (N % S == 0 ? false : is_prime_helping<N, S - 1>::value);
-    static const int minimal_divisor = (value ? N : is_prime_helping<N, S - 1>::value ? S : is_prime_helping<N, S - 1>::minimal_divisor);
-};
+#include "../residue.h/number_theory.h"
 
-template <unsigned N>
-struct is_prime_helping <N, 1> {
-    static const bool value = true;
-    static const int minimal_divisor = N;
-};
 template <unsigned N>
 struct is_prime {
-    static const bool value = is_prime_helping<N, static_cast<unsigned>(sqrt(N))>::value;
-};
-
-template <>
-struct is_prime<1> {
-    static const bool value = false;
-};
-
-template <unsigned N>
-    const bool is_prime_v = is_prime<N>::value;
-
-template <unsigned N, unsigned P>
-struct is_degree_of_prime {
-    static const bool value = N % P == 0 ? is_degree_of_prime<N / P, P>::value : false;
+    static const bool value = is_prime_number(N);
 };
 
 template <unsigned N>
-struct is_degree_of_prime<N, 1> {
-    static const bool value = false;
-};
-template <unsigned N>
-struct is_degree_of_prime<N, 0> {
-    static const bool value = false;
-};
-
-template <unsigned P>
-struct is_degree_of_prime<1, P> {
-    static const bool value = true;
-};
-template <unsigned P>
-struct is_degree_of_prime<0, P> {
-    static const bool value = false;
-};
-
+const bool is_prime_v = is_prime<N>::value;
 
-template <unsigned N>
-struct is_degree_of_prime_general {
-    static const bool value = is_degree_of_prime<N, is_prime_helping<N, static_cast<int>(sqrt(N))>::minimal_divisor>::value;
-};
 template <unsigned N>
 struct has_primitive_root {
-    static const bool value = N % 4 == 0 ? false : is_degree_of_prime_general<N % 2 == 0 ? N / 2 : N>::value;
-};
-template <>
-struct has_primitive_root<1> {
-    static const bool value = false;
-};
-
-template <>
-struct has_primitive_root<2> {
-    static const bool value = true;
-};
-
-template <>
-struct has_primitive_root<4> {
-    static const bool value = true;
+    static const bool value = has_primitive_root_number(N);
 };
 
-
 template <unsigned N>
 const bool has_primitive_root_v = has_primitive_root<N>::value;
 
@@ -825,20 +772,20 @@ struct is_same<T, T> {
 template <typename T, typename U>
 const bool is_same_v = is_same<T, U>::value;
 
-int gcd(int x, int y) {
-    if (x == 0) return y;
-    return gcd(y % x, x);
-}
-
 template <unsigned N>
 class Residue {
 private:
     unsigned int number = 0;
-    static const unsigned EF;
+    static constexpr unsigned EF = euler_function(N);
 public:
 
+    // inputs in (-N, N), the common case, take one conditional add and no division
     explicit Residue(int x) {
-        number = (1LL * x + 1LL * (-x / N  + 2) * N) % N;
+        const long long n = N;
+        long long y = x < 0 ? x + n : x;
+        if (y < 0 || y >= n)
+            y = (x % n + n) % n;
+        number = y;
     }
     Residue(): number(0) {}
     explicit operator int() const {
@@ -849,12 +796,12 @@ public:
         number = x;
         return *this;
     }
-    Residue<N>& operator=(const Residue<N>& x) {
-        number = x.number;
-        return *this;
-    }
+    // defaulted so that Residue stays trivially copyable and can be stored as raw bytes
+    Residue<N>& operator=(const Residue<N>& x) = default;
+    // conditional subtraction instead of % N; the sum may need 33 bits for N > 2^31
     Residue<N>& operator+=(const Residue<N>& x) {
-        number = (x.number + number) % N;
+        uint64_t sum = static_cast<uint64_t>(number) + x.number;
+        number = sum >= N ? sum - N : sum;
         return *this;
     }
     Residue<N> operator+(const Residue<N>& x) const {
@@ -864,11 +811,13 @@ public:
     }
 
     Residue<N> operator-() const {
-        Residue<N> a((N - number) % N);
+        Residue<N> a;
+        a -= *this;
         return a;
     }
     Residue<N>& operator-=(const Residue<N>& x) {
-        number = (number - x.number + N) % N;
+        unsigned difference = number - x.number;
+        number = number < x.number ? difference + N : difference;
         return *this;
     }
     Residue<N> operator-(const Residue<N>& x) const {
@@ -925,12 +874,15 @@ public:
         if (number == 1)
             return 1;
 
+        // the order divides EF: strip every prime factor of EF that is not needed
+        constexpr prime_factorization f = factorize(EF);
         unsigned int ans = EF;
-        for (unsigned i = 1; i * i <= EF; ++i) {
-            if (static_cast<int>(pow(i)) == 1)
-                ans = std::min(ans, i);
-            if (static_cast<int>(pow(EF / i)) == 1)
-                ans = std::min(ans, EF / i);
+        for (unsigned i = 0; i < f.count; ++i) {
+            for (unsigned k = 0; k < f.powers[i]; ++k) {
+                if (static_cast<int>(pow(ans / f.primes[i])) != 1)
+                    break;
+                ans /= f.primes[i];
+            }
         }
         assert(static_cast<int>(pow(ans)) == 1);
         return ans;
@@ -940,11 +892,8 @@ public:
         compilation_error<has_primitive_root_v<N>> a;
         a = a;
 
-        for (unsigned i = 1; i < N; ++i) {
-            if (Residue<N>(i).order() == EF)
-                return Residue<N>(i);
-        }
-        return Residue<N>(0);
+        constexpr unsigned root = primitive_root(N);
+        return Residue<N>(root);
     }
 
 };
@@ -958,9 +907,6 @@ bool operator!=(const Residue<N>& a, int b) {
     return a != Residue<N>(b);
 }
 
-template <unsigned N>
-const unsigned Residue<N>::EF = euler_function(N);
-
 template <unsigned N>
 std::istream& operator>>(std::istream& in, Residue<N>& i) {
     int a;
@@ -969,265 +915,229 @@ std::istream& operator>>(std::istream& in, Residue<N>& i) {
     return in;
 }
 
-#include <initializer_list>
+#include "../residue.h/dynamic_residue.h"
 
+#include "../residue.h/residue64.h"
 
+// Modulus and value of the residue types crt() combines.
+template <typename T>
+struct residue_traits;
 
-template <unsigned M, unsigned N, typename Field = Rational>
-class Matrix {
-template <unsigned M1, unsigned N1, unsigned K, typename Field1>
-friend Matrix<M1, N1, Field1> strassen(const Matrix<M1, K, Field1>& a, const Matrix<K, N1, Field1>& b);
-private:
-    std::vector < std::vector < Field > > core;//(M, std::vector<Field>(N));
-public:
-    Matrix() {
-        core.resize(M);
-        for (unsigned i = 0; i < M; ++i) {
-            core[i].resize(N);
-        }
+template <unsigned N>
+struct residue_traits<Residue<N>> {
+    static const uint64_t modulus = N;
+    static uint64_t value(const Residue<N>& x) {
+        return static_cast<uint32_t>(static_cast<int>(x));
     }
+};
 
-    Matrix(const std::initializer_list<std::vector<int>> &I){
-        core.resize(M);
-        int it = 0;
-        for (auto &i : I) {
-            core[it].resize(N);
-            for (unsigned j = 0; j < i.size(); ++j) {
-                core[it][j] = Field(i[j]);
-            }
-            ++it;
-        }
+template <uint64_t N>
+struct residue_traits<Residue64<N>> {
+    static const uint64_t modulus = N;
+    static uint64_t value(const Residue64<N>& x) {
+        return static_cast<uint64_t>(x);
     }
-    Matrix(const std::initializer_list<std::initializer_list<int>> &I){
-        core.resize(M);
-        int it = 0;
-        for (auto &i : I) {
-            core[it].resize(N);
-            int it2 = 0;
-            for (auto &j : i) {
-                core[it][it2] = Field(j);
-                ++it2;
-            }
-            ++it;
+};
+
+// Garner's constants for the moduli N_1, ..., N_k: the inverse of N_1 ... N_{i-1} modulo
+// N_i, 0 when they are not coprime.
+template <uint64_t... N>
+constexpr std::array<uint64_t, sizeof...(N)> garner_inverses() {
+    std::array<uint64_t, sizeof...(N)> moduli = {{N...}};
+    std::array<uint64_t, sizeof...(N)> result = {};
+    for (size_t i = 0; i < moduli.size(); ++i) {
+        uint64_t prefix = 1 % moduli[i];
+        for (size_t j = 0; j < i; ++j) {
+            prefix = multiply_mod64(prefix, moduli[j], moduli[i]);
         }
+        result[i] = inverse_mod64(prefix, moduli[i]);
     }
-    Matrix(const std::vector < std::vector < int > > &I) {
-        core.resize(M);
-        int it = 0;
-        for (auto &i : I) {
-            core[it].resize(N);
-            for (size_t j = 0; j < i.size(); ++j) {
-                core[it][j] = Field(i[j]);
-            }
-            ++it;
-        }
+    return result;
+}
+
+template <uint64_t... N>
+constexpr bool pairwise_coprime() {
+    std::array<uint64_t, sizeof...(N)> moduli = {{N...}};
+    std::array<uint64_t, sizeof...(N)> inverses = garner_inverses<N...>();
+    for (size_t i = 0; i < moduli.size(); ++i) {
+        if (moduli[i] > 1 && inverses[i] == 0)
+            return false;
     }
-    Matrix(const std::vector < std::vector < Field > > &I) {
-        core.resize(M);
-        int it = 0;
-        for (auto &i : I) {
-            core[it].resize(N);
-            for (size_t j = 0; j < i.size(); ++j) {
-                core[it][j] = i[j];
-            }
-            ++it;
+    return true;
+}
+
+BigInteger big_integer_of(uint64_t x) {
+    if (x <= static_cast<uint64_t>(std::numeric_limits<long long>::max()))
+        return BigInteger(static_cast<long long>(x));
+    return BigInteger(static_cast<long long>(x / 2)) * BigInteger(2LL) + BigInteger(static_cast<long long>(x % 2));
+}
+
+// The x < N_1 ... N_k with x = r_i (mod N_i), for Residue and Residue64 of pairwise
+// coprime moduli. Garner's algorithm finds the mixed-radix digits
+// x = v_1 + v_2 N_1 + ... + v_k N_1 ... N_{k-1} in machine words with the inverses fixed
+// at compile time; only the final Horner evaluation touches BigInteger.
+template <typename... R>
+BigInteger crt(const R&... residues) {
+    compilation_error<(sizeof...(R) > 0) && pairwise_coprime<residue_traits<R>::modulus...>()> a;
+    a = a;
+
+    constexpr std::array<uint64_t, sizeof...(R)> inverses = garner_inverses<residue_traits<R>::modulus...>();
+    const uint64_t moduli[] = {residue_traits<R>::modulus...};
+    const uint64_t values[] = {residue_traits<R>::value(residues)...};
+    uint64_t digits[sizeof...(R)];
+    for (size_t i = 0; i < sizeof...(R); ++i) {
+        const uint64_t m = moduli[i];
+        // the digits so far, evaluated modulo N_i
+        uint64_t prefix = 0;
+        for (size_t j = i; j-- > 0;) {
+            uint64_t digit = digits[j] % m;
+            prefix = multiply_mod64(prefix, moduli[j], m);
+            prefix = prefix >= m - digit ? prefix - (m - digit) : prefix + digit;
         }
+        uint64_t difference = values[i] >= prefix ? values[i] - prefix : values[i] + (m - prefix);
+        digits[i] = multiply_mod64(difference, inverses[i], m);
     }
-    Matrix(const Matrix& a) {
-        core.resize(M);
-        for (unsigned i = 0; i < M; ++i) {
-            core[i].resize(N);
-            for (unsigned j = 0; j < N; ++j) {
-                core[i][j] = a[i][j];
-            }
-        }
+    BigInteger result;
+    for (size_t i = sizeof...(R); i-- > 0;) {
+        result *= big_integer_of(moduli[i]);
+        result += big_integer_of(digits[i]);
     }
-    Matrix<M, N, Field>& operator=(const Matrix<M, N, Field>&);//
-    Matrix<M, N, Field>& operator+=(const Matrix<M, N, Field>&);//
-    Matrix<M, N, Field> operator+(const Matrix<M, N, Field>&) const;//
-    Matrix<M, N, Field>& operator-=(const Matrix<M, N, Field>&);//
-    Matrix<M, N, Field> operator-(const Matrix<M, N, Field>&) const;//
-    Matrix<M, N, Field>& operator*=(const Field&);//
-    Matrix<M, N, Field> operator*(const Field&) const;//
-
-    Matrix<N, M, Field> transposed() const;//
-    Matrix<M, N, Field> getGauss() const;//
-    unsigned rank() const;//
-
-    std::vector<Field> getRow(unsigned) const;//
-    std::vector<Field> getColumn(unsigned) const;//
-
-    std::vector<Field>& operator[](unsigned);//
-    std::vector<Field> operator[](unsigned) const;//
-
-//squared:
-    Matrix<M, N, Field>& operator*=(Matrix<M, N, Field>& a);
-    Field det() const;//
-    Matrix<M, N, Field> inverted() const;
-    void invert();
-    Field trace() const;//
-};
-
-template <unsigned M, unsigned N, unsigned K, typename Field>
-Matrix<M, N, Field> operator*(const Matrix<M, K, Field>&, const Matrix<K, N, Field>&);//
-
-template <unsigned M, unsigned N, unsigned K, unsigned L, typename Field>
-bool operator==(const Matrix<M, N, Field>&, const Matrix<K, L, Field>&);//
-
-template <unsigned M, unsigned N, unsigned K, unsigned L, typename Field>
-bool operator!=(const Matrix<M, N, Field>&, const Matrix<K, L, Field>&);//
-
-template <unsigned M, unsigned N, typename Field>
-Matrix<M, N, Field> operator*(const Field&, const Matrix<M, N, Field>&);//
-
-template <unsigned N, typename Field = Rational>
-using SquareMatrix = Matrix<N, N, Field>;
+    return result;
+}
 
+#include <initializer_list>
 
+#include <assert.h>
 
-//---------------------------------------------------------------------------------------------------------------------------------------
+template <typename T>
+bool compare_to_zero(const T& a) {
+    return a == 0;
+}
 
+template <>
+bool compare_to_zero<Rational>(const Rational& a) {
+    return a.numerator == 0;
+}
+const double eps = 1e-7;
+template<>
+bool compare_to_zero<double>(const double& a) {
+    return std::abs(a) < eps;
+}
+const int kek = 17;
+template <typename T>
+bool is_better_pivot(const T& candidate, const T& current) {
+    return compare_to_zero(current) && !compare_to_zero(candidate);
+}
 
-template<unsigned M, unsigned N, typename Field>
-Matrix<M, N, Field>& Matrix<M, N, Field>::operator=(const Matrix<M, N, Field>& a) {
-    core = a.core;
-    return *this;
+template <>
+bool is_better_pivot<double>(const double& candidate, const double& current) {
+    return std::abs(candidate) > std::abs(current);
 }
 
-template<unsigned M, unsigned N, typename Field>
-Matrix<M, N, Field>& Matrix<M, N, Field>::operator+=(const Matrix<M, N, Field>& a) {
-    for (unsigned i = 0; i < M; ++i) {
-        for (unsigned j = 0; j < N; ++j) {
-            core[i][j] += a[i][j];
-        }
-    }
-    return *this;
+// For similarity transforms, which must not drop entries: unlike compare_to_zero, no
+// tolerance for double.
+template <typename T>
+bool is_exact_zero(const T& a) {
+    return compare_to_zero(a);
 }
 
-template<unsigned M, unsigned N, typename Field>
-Matrix<M, N, Field> Matrix<M, N, Field>::operator+(const Matrix<M, N, Field>& a) const {
-    Matrix<M, N, Field> res = *this;
-    return res += a;
+template <>
+bool is_exact_zero<double>(const double& a) {
+    return a == 0;
 }
 
-template<unsigned M, unsigned N, typename Field>
-Matrix<M, N, Field>& Matrix<M, N, Field>::operator-=(const Matrix<M, N, Field>& a) {
-    for (unsigned i = 0; i < M; ++i) {
-        for (unsigned j = 0; j < N; ++j) {
-            core[i][j] -= a[i][j];
+// Storage-agnostic kernels. Matrix<M, N> and DynamicMatrix both keep a vector of rows and
+// hand it here together with the dimensions, so each algorithm is instantiated once per Field
+// instead of once per shape.
+
+// c = a * b into an already allocated m x n table, c must not alias a or b
+template <typename Field>
+void multiply_into_kernel(const std::vector<std::vector<Field>>& a, const std::vector<std::vector<Field>>& b,
+                          std::vector<std::vector<Field>>& c, unsigned m, unsigned n, unsigned k) {
+    for (unsigned i = 0; i < m; ++i) {
+        std::vector<Field>& row = c[i];
+        std::fill(row.begin(), row.end(), Field(0));
+        for (unsigned t = 0; t < k; ++t) {
+            const Field& x = a[i][t];
+            const std::vector<Field>& b_row = b[t];
+            for (unsigned j = 0; j < n; ++j) {
+                row[j] += x * b_row[j];
+            }
         }
     }
-    return *this;
-}
-
-template<unsigned M, unsigned N, typename Field>
-Matrix<M, N, Field> Matrix<M, N, Field>::operator-(const Matrix<M, N, Field>& a) const {
-    Matrix<M, N, Field> res = *this;
-    return res -= a;
 }
 
-template <unsigned M, unsigned N, unsigned K, unsigned L, typename Field>
-bool operator==(const Matrix<M, N, Field>& a, const Matrix<K, L, Field>& b) {
-    if (M != K || N != L)
-        return false;
-
-    for (unsigned i = 0; i < M; ++i) {
-        for (unsigned j = 0; j < N; ++j) {
-            if (a[i][j] != b[i][j])
-                return false;
+// Residue<P> with P < 2^31: raw values are multiplied into 64-bit accumulators that are
+// reduced only once every `lazy` terms instead of twice per term; the inner loop works on
+// flat unsigned arrays and vectorizes, and % by the constant P compiles to a multiply-high.
+template <unsigned P>
+void multiply_into_kernel(const std::vector<std::vector<Residue<P>>>& a, const std::vector<std::vector<Residue<P>>>& b,
+                          std::vector<std::vector<Residue<P>>>& c, unsigned m, unsigned n, unsigned k) {
+    if (P >= (1u << 31)) {
+        multiply_into_kernel<Residue<P>>(a, b, c, m, n, k);
+        return;
+    }
+    const unsigned long long max_product = 1ULL * (P - 1) * (P - 1);
+    const unsigned long long lazy = max_product == 0 ? k : (~0ULL - P) / max_product;
+    std::vector<unsigned> b_raw(1ULL * k * n);
+    for (unsigned t = 0; t < k; ++t) {
+        for (unsigned j = 0; j < n; ++j) {
+            b_raw[1ULL * t * n + j] = static_cast<int>(b[t][j]);
+        }
+    }
+    std::vector<unsigned long long> accumulator(n);
+    for (unsigned i = 0; i < m; ++i) {
+        std::fill(accumulator.begin(), accumulator.end(), 0);
+        unsigned long long pending = 0;
+        for (unsigned t = 0; t < k; ++t) {
+            unsigned long long x = static_cast<int>(a[i][t]);
+            if (x == 0)
+                continue;
+            const unsigned* b_row = b_raw.data() + 1ULL * t * n;
+            unsigned long long* acc = accumulator.data();
+            for (unsigned j = 0; j < n; ++j) {
+                acc[j] += x * b_row[j];
+            }
+            if (++pending == lazy) {
+                for (unsigned j = 0; j < n; ++j) {
+                    acc[j] %= P;
+                }
+                pending = 0;
+            }
+        }
+        for (unsigned j = 0; j < n; ++j) {
+            c[i][j] = static_cast<int>(accumulator[j] % P);
         }
     }
-    return true;
 }
 
-template <unsigned M, unsigned N, unsigned K, unsigned L, typename Field>
-bool operator!=(const Matrix<M, N, Field>& a, const Matrix<K, L, Field>& b) {
-    return !(a == b);
+template <typename Field>
+std::vector<std::vector<Field>> naive_multiply_kernel(const std::vector<std::vector<Field>>& a,
+                                                      const std::vector<std::vector<Field>>& b,
+                                                      unsigned m, unsigned n, unsigned k) {
+    std::vector<std::vector<Field>> c(m, std::vector<Field>(n));
+    multiply_into_kernel(a, b, c, m, n, k);
+    return c;
 }
 
-template<unsigned M, unsigned N, typename Field>
-Matrix<M, N, Field>& Matrix<M, N, Field>::operator*=(const Field& a) {
-    for (unsigned i = 0; i < M; ++i) {
-        for (unsigned j = 0; j < N; ++j) {
-            core[i][j] *= a;
+template<typename Field>
+std::vector<std::vector<Field>> sum(std::vector<std::vector<Field>> a, std::vector<std::vector<Field>> b, bool is_dif = false) {
+    std::vector<std::vector<Field>> result(a.size(), std::vector<Field>(a.size()));
+    int n = a.size();
+    for (int i = 0; i < n; ++i) {
+        for (int j = 0; j < n; ++j) {
+            result[i][j] = a[i][j] + (is_dif ? -b[i][j] : b[i][j]);
         }
     }
-    return *this;
-}
-
-template<unsigned M, unsigned N, typename Field>
-Matrix<M, N, Field> Matrix<M, N, Field>::operator*(const Field& a) const {
-    Matrix<M, N, Field> res = *this;
-    return res *= a;
-}
-template<unsigned M, unsigned N, typename Field>
-Matrix<M, N, Field> operator*(const Field& a, const Matrix<M, N, Field>& b) {
-    return b * a;
-}
-
-
-template<unsigned M, unsigned N, typename Field>
-Matrix<N, M, Field> Matrix<M, N, Field>::transposed() const {
-    Matrix<N, M, Field> res;
-    for (unsigned i = 0; i < M; ++i) {
-        for (unsigned j = 0; j < N; ++j) {
-            res[j][i] = core[i][j];
-        }
-    }
-    return res;
-}
-template<unsigned M, unsigned N, typename Field>
-std::vector < Field > Matrix<M, N, Field>::getRow(unsigned i) const {
-    return (*this)[i];
-}
-
-template<unsigned M, unsigned N, typename Field>
-std::vector < Field > Matrix<M, N, Field>::getColumn(unsigned i) const {
-    std::vector < Field > res(M);
-    for (unsigned j = 0; j < M; ++j) {
-        res[j] = core[j][i];
-    }
-    return res;
-}
-template <unsigned M, unsigned N, typename Field>
-std::vector<Field>& Matrix<M, N, Field>::operator[](unsigned i) {
-    return core[i];
-}
-template <unsigned M, unsigned N, typename Field>
-std::vector<Field> Matrix<M, N, Field>::operator[](unsigned i) const {
-    return core[i];
-}
-template <unsigned M, unsigned N, typename Field>
-Field Matrix<M, N, Field>::trace() const {
-    if (M != N) {
-        compilation_error<M == N> a;
-        a = a;
-    }
-    Field res;
-    res = 0;
-    for (unsigned i = 0; i < M; ++i) {
-        res += core[i][i];
-    }
-    return res;
-}
-
-template<typename Field>
-std::vector<std::vector<Field>> sum(std::vector<std::vector<Field>> a, std::vector<std::vector<Field>> b, bool is_dif = false) {
-    std::vector<std::vector<Field>> result(a.size(), std::vector<Field>(a.size() / 2));
-    int n = a.size();
-    for (int i = 0; i < n; ++i) {
-        for (int j = 0; j < n; ++j) {
-            result[i][j] = a[i][j] + (is_dif ? -b[i][j] : b[i][j]);
-        }
-    }
-    return result;
+    return result;
 }
 
 template<typename Field>
-std::vector<std::vector<Field>> solve_strassen(std::vector<std::vector<Field>> a, std::vector<std::vector<Field>> b) {
+std::vector<std::vector<Field>> solve_strassen(std::vector<std::vector<Field>> a, std::vector<std::vector<Field>> b,
+                                               unsigned leaf = MATRIX_STRASSEN_LEAF) {
     int n = a.size();
-    if (n == 1) {
-        return std::vector<std::vector<Field>>(1, std::vector<Field>(1, a[0][0] * b[0][0]));
+    if (n <= static_cast<int>(leaf)) {
+        return naive_multiply_kernel(a, b, n, n, n);
     }
     std::vector<std::vector<Field>> a11(n / 2, std::vector<Field>(n / 2));
     std::vector<std::vector<Field>> a12(n / 2, std::vector<Field>(n / 2));
@@ -1249,13 +1159,13 @@ std::vector<std::vector<Field>> solve_strassen(std::vector<std::vector<Field>> a
             b22[i][j] = b[i + n / 2][j + n / 2];
         }
     }
-    std::vector<std::vector<Field>> P1 = solve_strassen(sum(a11, a22), sum(b11, b22));
-    std::vector<std::vector<Field>> P2 = solve_strassen(sum(a21, a22), b11);
-    std::vector<std::vector<Field>> P3 = solve_strassen(a11, sum(b12, b22, true));
-    std::vector<std::vector<Field>> P4 = solve_strassen(a22, sum(b12, b11, true));
-    std::vector<std::vector<Field>> P5 = solve_strassen(sum(a11, a12), b22);
-    std::vector<std::vector<Field>> P6 = solve_strassen(sum(a21, a11, true), sum(b11, b12));
-    std::vector<std::vector<Field>> P7 = solve_strassen(sum(a12, a22, true), sum(b21, b22));
+    std::vector<std::vector<Field>> P1 = solve_strassen(sum(a11, a22), sum(b11, b22), leaf);
+    std::vector<std::vector<Field>> P2 = solve_strassen(sum(a21, a22), b11, leaf);
+    std::vector<std::vector<Field>> P3 = solve_strassen(a11, sum(b12, b22, true), leaf);
+    std::vector<std::vector<Field>> P4 = solve_strassen(a22, sum(b21, b11, true), leaf);
+    std::vector<std::vector<Field>> P5 = solve_strassen(sum(a11, a12), b22, leaf);
+    std::vector<std::vector<Field>> P6 = solve_strassen(sum(a21, a11, true), sum(b11, b12), leaf);
+    std::vector<std::vector<Field>> P7 = solve_strassen(sum(a12, a22, true), sum(b21, b22), leaf);
     std::vector<std::vector<Field>> c(n, std::vector<Field>(n));
     for (int i = 0; i < n / 2; ++i) {
         for (int j = 0; j < n / 2; ++j) {
@@ -1273,196 +1183,3478 @@ int get_size(int n) {
     while (ans < n) {
         ans *= 2;
     }
-    ans *= 2;
     return ans;
 }
-template <unsigned M, unsigned N, unsigned K, typename Field>
-Matrix<M, N, Field> strassen(const Matrix<M, K, Field>& a, const Matrix<K, N, Field>& b) {
-    std::vector<std::vector<Field>> new_a = a.core;
-    std::vector<std::vector<Field>> new_b = b.core;
-    int new_size = get_size(std::max(M, std::max(N, K)));
+template <typename Field>
+std::vector<std::vector<Field>> strassen_kernel(const std::vector<std::vector<Field>>& a,
+                                                const std::vector<std::vector<Field>>& b,
+                                                unsigned m, unsigned n, unsigned k,
+                                                unsigned leaf = MATRIX_STRASSEN_LEAF) {
+    std::vector<std::vector<Field>> new_a = a;
+    std::vector<std::vector<Field>> new_b = b;
+    int new_size = get_size(std::max(m, std::max(n, k)));
     new_a.resize(new_size);
     new_b.resize(new_size);
     for (int i = 0; i < new_size; ++i) {
         new_a[i].resize(new_size);
         new_b[i].resize(new_size);
     }
-    std::vector<std::vector<Field>> answer = solve_strassen(new_a, new_b);
-    answer.resize(M);
-    for (unsigned i = 0; i < M; ++i) {
-        answer[i].resize(N);
+    std::vector<std::vector<Field>> answer = solve_strassen(new_a, new_b, leaf);
+    answer.resize(m);
+    for (unsigned i = 0; i < m; ++i) {
+        answer[i].resize(n);
     }
-    Matrix<M, N, Field> result(answer);
-    return result;
+    return answer;
 }
-template <unsigned M, unsigned N, unsigned K, typename Field>
-Matrix<M, N, Field> operator*(const Matrix<M, K, Field>& a, const Matrix<K, N, Field>& b) {
-    if (M > 64 || N > 64)
-        return strassen(a, b);
-    Matrix <M, N, Field> result;
 
-    for (unsigned i = 0; i < M; ++i) {
-        for (unsigned j = 0; j < N; ++j) {
-            for (unsigned k = 0; k < K; ++k) {
-                result[i][j] += a[i][k] * b[k][j];
-            }
+template <typename Field>
+std::vector<std::vector<Field>> multiply_kernel(const std::vector<std::vector<Field>>& a,
+                                                const std::vector<std::vector<Field>>& b,
+                                                unsigned m, unsigned n, unsigned k) {
+    if (m > MATRIX_STRASSEN_THRESHOLD || n > MATRIX_STRASSEN_THRESHOLD)
+        return strassen_kernel(a, b, m, n, k);
+    return naive_multiply_kernel(a, b, m, n, k);
+}
+
+// the lazily reduced cubic kernel beats Strassen over row tables at every size
+template <unsigned P>
+std::vector<std::vector<Residue<P>>> multiply_kernel(const std::vector<std::vector<Residue<P>>>& a,
+                                                     const std::vector<std::vector<Residue<P>>>& b,
+                                                     unsigned m, unsigned n, unsigned k) {
+    return naive_multiply_kernel(a, b, m, n, k);
+}
+
+// a^k by repeated squaring; the three n x n buffers are allocated once and swapped,
+// so below the Strassen threshold no step allocates
+template <typename Field>
+std::vector<std::vector<Field>> power_kernel(const std::vector<std::vector<Field>>& a, unsigned n, unsigned long long k) {
+    std::vector<std::vector<Field>> result(n, std::vector<Field>(n, Field(0)));
+    for (unsigned i = 0; i < n; ++i) {
+        result[i][i] = Field(1);
+    }
+    std::vector<std::vector<Field>> base = a;
+    std::vector<std::vector<Field>> buffer(n, std::vector<Field>(n));
+    while (k > 0) {
+        if (k & 1) {
+            if (n > MATRIX_STRASSEN_THRESHOLD)
+                buffer = multiply_kernel(result, base, n, n, n);
+            else
+                multiply_into_kernel(result, base, buffer, n, n, n);
+            result.swap(buffer);
         }
+        k >>= 1;
+        if (k == 0)
+            break;
+        if (n > MATRIX_STRASSEN_THRESHOLD)
+            buffer = multiply_kernel(base, base, n, n, n);
+        else
+            multiply_into_kernel(base, base, buffer, n, n, n);
+        base.swap(buffer);
     }
-
     return result;
 }
-template <unsigned M, unsigned N, typename Field>
-Matrix<M, N, Field>& Matrix<M, N, Field>::operator*=(Matrix<M, N, Field>& a) {
-    if (M != N) {
-        compilation_error<M == N> a;
-        a = a;
+
+// p * q mod (x^d - c[0] x^(d-1) - ... - c[d-1]), p and q of degree < d
+template <typename Field>
+polynom<Field> multiply_mod_recurrence(const polynom<Field>& p, const polynom<Field>& q, const std::vector<Field>& c) {
+    unsigned d = c.size();
+    polynom<Field> product(2 * d - 1, Field(0));
+    for (unsigned i = 0; i < d; ++i) {
+        if (compare_to_zero(p[i]))
+            continue;
+        for (unsigned j = 0; j < d; ++j) {
+            product[i + j] += p[i] * q[j];
+        }
     }
-    if (M > 64) {
-        Matrix<M, N, Field> answer = strassen(*this, a);
-        return *this = answer;
+    for (unsigned i = 2 * d - 2; i >= d; --i) {
+        if (compare_to_zero(product[i]))
+            continue;
+        for (unsigned j = 1; j <= d; ++j) {
+            product[i - j] += product[i] * c[j - 1];
+        }
     }
-    for (unsigned i = 0; i < M; ++i) {
-        std::vector < Field > copy = core[i];
-        for (unsigned j = 0; j < M; ++j) {
-            core[i][j] = 0;
-            for (unsigned k = 0; k < M; ++k) {
-                core[i][j] += copy[k] * a[k][j];
+    product.resize(d);
+    return product;
+}
+
+// Kitamasa: k-th term of a[n] = c[0] a[n - 1] + ... + c[d - 1] a[n - d] given a[0..d-1],
+// in O(d^2 log k) instead of the O(d^3 log k) of powering the companion matrix.
+template <typename Field>
+Field linear_recurrence_term(const std::vector<Field>& c, const std::vector<Field>& a, unsigned long long k) {
+    unsigned d = c.size();
+    assert(d > 0 && a.size() >= d);
+    if (k < d)
+        return a[k];
+    polynom<Field> result(d, Field(0));
+    polynom<Field> base(d, Field(0));
+    result[0] = Field(1);
+    if (d == 1)
+        base[0] = c[0];
+    else
+        base[1] = Field(1);
+    while (k > 0) {
+        if (k & 1)
+            result = multiply_mod_recurrence(result, base, c);
+        k >>= 1;
+        if (k > 0)
+            base = multiply_mod_recurrence(base, base, c);
+    }
+    Field answer(0);
+    for (unsigned i = 0; i < d; ++i) {
+        answer += result[i] * a[i];
+    }
+    return answer;
+}
+
+// Cache-oblivious transpose: the longer side is halved until a block fits in cache,
+// so both the reads and the strided writes stay within a few lines and pages.
+template <typename Field>
+void transpose_block(const std::vector<std::vector<Field>>& src, std::vector<std::vector<Field>>& dst,
+                     unsigned r0, unsigned r1, unsigned c0, unsigned c1, unsigned block = MATRIX_TRANSPOSE_BLOCK) {
+    if ((r1 - r0) * (c1 - c0) <= block) {
+        for (unsigned i = r0; i < r1; ++i) {
+            const std::vector<Field>& row = src[i];
+            for (unsigned j = c0; j < c1; ++j) {
+                dst[j][i] = row[j];
             }
         }
+        return;
+    }
+    if (r1 - r0 >= c1 - c0) {
+        unsigned middle = (r0 + r1) / 2;
+        transpose_block(src, dst, r0, middle, c0, c1, block);
+        transpose_block(src, dst, middle, r1, c0, c1, block);
+    } else {
+        unsigned middle = (c0 + c1) / 2;
+        transpose_block(src, dst, r0, r1, c0, middle, block);
+        transpose_block(src, dst, r0, r1, middle, c1, block);
     }
-    return *this;
 }
-#include <assert.h>
 
-template <typename T>
-bool compare_to_zero(T& a) {
-    return a == 0;
+template <typename Field>
+void transpose_kernel(const std::vector<std::vector<Field>>& src, std::vector<std::vector<Field>>& dst,
+                      unsigned rows, unsigned cols, unsigned block = MATRIX_TRANSPOSE_BLOCK) {
+    transpose_block(src, dst, 0, rows, 0, cols, block);
 }
 
-template <>
-bool compare_to_zero<Rational>(Rational& a) {
-    return a.numerator == 0;
+// swaps the block [r0, r1) x [c0, c1) with its mirror image [c0, c1) x [r0, r1)
+template <typename Field>
+void swap_transposed_blocks(std::vector<std::vector<Field>>& a, unsigned r0, unsigned r1, unsigned c0, unsigned c1,
+                            unsigned block = MATRIX_TRANSPOSE_BLOCK) {
+    if ((r1 - r0) * (c1 - c0) <= block) {
+        for (unsigned i = r0; i < r1; ++i) {
+            for (unsigned j = c0; j < c1; ++j) {
+                std::swap(a[i][j], a[j][i]);
+            }
+        }
+        return;
+    }
+    if (r1 - r0 >= c1 - c0) {
+        unsigned middle = (r0 + r1) / 2;
+        swap_transposed_blocks(a, r0, middle, c0, c1, block);
+        swap_transposed_blocks(a, middle, r1, c0, c1, block);
+    } else {
+        unsigned middle = (c0 + c1) / 2;
+        swap_transposed_blocks(a, r0, r1, c0, middle, block);
+        swap_transposed_blocks(a, r0, r1, middle, c1, block);
+    }
 }
-const double eps = 1e-7;
-template<>
-bool compare_to_zero<double>(double& a) {
-    return abs(a) < eps;
+
+// in-place transpose of the diagonal block [lo, hi) x [lo, hi)
+template <typename Field>
+void transpose_in_place_kernel(std::vector<std::vector<Field>>& a, unsigned lo, unsigned hi,
+                               unsigned block = MATRIX_TRANSPOSE_BLOCK) {
+    if ((hi - lo) * (hi - lo) <= block) {
+        for (unsigned i = lo; i < hi; ++i) {
+            for (unsigned j = i + 1; j < hi; ++j) {
+                std::swap(a[i][j], a[j][i]);
+            }
+        }
+        return;
+    }
+    unsigned middle = (lo + hi) / 2;
+    transpose_in_place_kernel(a, lo, middle, block);
+    transpose_in_place_kernel(a, middle, hi, block);
+    swap_transposed_blocks(a, lo, middle, middle, hi, block);
 }
-const int kek = 17;
-template <unsigned M, unsigned N, typename Field>
-Matrix<M, N, Field> Matrix<M, N, Field>::getGauss() const {
-    Matrix<M, N, Field> h(core);
+
+// a^T * b for a of size k x m and b of size k x n: both operands are walked row by row
+template <typename Field>
+std::vector<std::vector<Field>> transposed_multiply_kernel(const std::vector<std::vector<Field>>& a,
+                                                           const std::vector<std::vector<Field>>& b,
+                                                           unsigned m, unsigned n, unsigned k) {
+    std::vector<std::vector<Field>> c(m, std::vector<Field>(n));
+    for (unsigned t = 0; t < k; ++t) {
+        const std::vector<Field>& a_row = a[t];
+        const std::vector<Field>& b_row = b[t];
+        for (unsigned i = 0; i < m; ++i) {
+            const Field& x = a_row[i];
+            if (compare_to_zero(x))
+                continue;
+            std::vector<Field>& row = c[i];
+            for (unsigned j = 0; j < n; ++j) {
+                row[j] += x * b_row[j];
+            }
+        }
+    }
+    return c;
+}
+
+// Gaussian elimination in place, returns the number of pivots.
+// Rows [0, place) are the pivot rows found so far and every row below is already zero in
+// their columns, so the pivot of column J is looked up among rows [place, rows) only:
+// the largest one in magnitude for double, the first non-zero one for exact fields.
+// The result is in row-echelon form with exactly rank leading non-zero rows; with reduced
+// the pivot columns are cleared above the pivots as well (Gauss-Jordan).
+template <typename Field>
+unsigned gauss_kernel(std::vector<std::vector<Field>>& h, unsigned rows, unsigned cols, bool reduced = true) {
     unsigned place = 0;
-    int ans = 0;
-    for (unsigned J = 0; J < M; ++J) {
-        int pos = -1;
-        for (unsigned i = 0; i < M; ++i) {
-            if (!compare_to_zero(h[i][J])) {
-                bool fl = 0;
-                for (unsigned j = 0; j < J; ++j) {
-                    if (h[i][j] != 0) {
-                        fl = 1;
-                        break;
-                    }
-                }
-                if (fl) continue;
+    for (unsigned J = 0; J < cols && place < rows; ++J) {
+        unsigned pos = place;
+        for (unsigned i = place + 1; i < rows; ++i) {
+            if (is_better_pivot(h[i][J], h[pos][J]))
                 pos = i;
-                break;
+        }
+        if (compare_to_zero(h[pos][J]))
+            continue;
+        std::swap(h[pos], h[place]);
+        const std::vector<Field>& pivot_row = h[place];
+        for (unsigned i = reduced ? 0 : place + 1; i < rows; ++i) {
+            if (i == place || compare_to_zero(h[i][J]))
+                continue;
+            std::vector<Field>& row = h[i];
+            Field con = row[J] / pivot_row[J];
+            for (unsigned j = J + 1; j < cols; ++j) {
+                row[j] -= pivot_row[j] * con;
             }
+            row[J] = Field(0);
         }
-        if (pos != -1) {
-            std::swap(h.core[pos], h.core[place]);
-            ++ans;
-            pos = place;
-            ++place;
-            for (unsigned i = 0; i < M; ++i) {
-                if (!compare_to_zero(h[i][J]) && i != static_cast<unsigned>(pos)) {
-                    Field con = h[i][J] / h[pos][J];
-                    for (unsigned j = J; j < N; ++j) {
-                        h[i][j] -= h[pos][j] * con;
+        ++place;
+    }
+    return place;
+}
 
-                        assert(compare_to_zero(h[i][J]));
-                    }
-                }
-            }
+// Closed forms for n <= 4. a(i, j) reads an element and out(i, j, x) stores one, so the same
+// formulas serve row tables and the lanes of a MatrixBatch.
+template <typename Field, typename Access>
+Field small_det(const Access& a, unsigned n) {
+    switch (n) {
+        case 1:
+            return a(0, 0);
+        case 2:
+            return a(0, 0) * a(1, 1) - a(0, 1) * a(1, 0);
+        case 3:
+            return a(0, 0) * (a(1, 1) * a(2, 2) - a(1, 2) * a(2, 1))
+                   - a(0, 1) * (a(1, 0) * a(2, 2) - a(1, 2) * a(2, 0))
+                   + a(0, 2) * (a(1, 0) * a(2, 1) - a(1, 1) * a(2, 0));
+        default: {
+            Field s0 = a(0, 0) * a(1, 1) - a(1, 0) * a(0, 1);
+            Field s1 = a(0, 0) * a(1, 2) - a(1, 0) * a(0, 2);
+            Field s2 = a(0, 0) * a(1, 3) - a(1, 0) * a(0, 3);
+            Field s3 = a(0, 1) * a(1, 2) - a(1, 1) * a(0, 2);
+            Field s4 = a(0, 1) * a(1, 3) - a(1, 1) * a(0, 3);
+            Field s5 = a(0, 2) * a(1, 3) - a(1, 2) * a(0, 3);
+            Field c0 = a(2, 0) * a(3, 1) - a(3, 0) * a(2, 1);
+            Field c1 = a(2, 0) * a(3, 2) - a(3, 0) * a(2, 2);
+            Field c2 = a(2, 0) * a(3, 3) - a(3, 0) * a(2, 3);
+            Field c3 = a(2, 1) * a(3, 2) - a(3, 1) * a(2, 2);
+            Field c4 = a(2, 1) * a(3, 3) - a(3, 1) * a(2, 3);
+            Field c5 = a(2, 2) * a(3, 3) - a(3, 2) * a(2, 3);
+            return s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+        }
+    }
+}
+
+// adjugate divided by the determinant
+template <typename Field, typename Access, typename Store>
+void small_inverse(const Access& a, const Store& out, unsigned n) {
+    switch (n) {
+        case 1:
+            out(0, 0, Field(1) / a(0, 0));
+            return;
+        case 2: {
+            Field d = a(0, 0) * a(1, 1) - a(0, 1) * a(1, 0);
+            out(0, 0, a(1, 1) / d);
+            out(0, 1, (Field(0) - a(0, 1)) / d);
+            out(1, 0, (Field(0) - a(1, 0)) / d);
+            out(1, 1, a(0, 0) / d);
+            return;
+        }
+        case 3: {
+            Field c00 = a(1, 1) * a(2, 2) - a(1, 2) * a(2, 1);
+            Field c01 = a(1, 2) * a(2, 0) - a(1, 0) * a(2, 2);
+            Field c02 = a(1, 0) * a(2, 1) - a(1, 1) * a(2, 0);
+            Field inv = Field(1) / (a(0, 0) * c00 + a(0, 1) * c01 + a(0, 2) * c02);
+            out(0, 0, c00 * inv);
+            out(1, 0, c01 * inv);
+            out(2, 0, c02 * inv);
+            out(0, 1, (a(0, 2) * a(2, 1) - a(0, 1) * a(2, 2)) * inv);
+            out(1, 1, (a(0, 0) * a(2, 2) - a(0, 2) * a(2, 0)) * inv);
+            out(2, 1, (a(0, 1) * a(2, 0) - a(0, 0) * a(2, 1)) * inv);
+            out(0, 2, (a(0, 1) * a(1, 2) - a(0, 2) * a(1, 1)) * inv);
+            out(1, 2, (a(0, 2) * a(1, 0) - a(0, 0) * a(1, 2)) * inv);
+            out(2, 2, (a(0, 0) * a(1, 1) - a(0, 1) * a(1, 0)) * inv);
+            return;
+        }
+        default: {
+            Field s0 = a(0, 0) * a(1, 1) - a(1, 0) * a(0, 1);
+            Field s1 = a(0, 0) * a(1, 2) - a(1, 0) * a(0, 2);
+            Field s2 = a(0, 0) * a(1, 3) - a(1, 0) * a(0, 3);
+            Field s3 = a(0, 1) * a(1, 2) - a(1, 1) * a(0, 2);
+            Field s4 = a(0, 1) * a(1, 3) - a(1, 1) * a(0, 3);
+            Field s5 = a(0, 2) * a(1, 3) - a(1, 2) * a(0, 3);
+            Field c0 = a(2, 0) * a(3, 1) - a(3, 0) * a(2, 1);
+            Field c1 = a(2, 0) * a(3, 2) - a(3, 0) * a(2, 2);
+            Field c2 = a(2, 0) * a(3, 3) - a(3, 0) * a(2, 3);
+            Field c3 = a(2, 1) * a(3, 2) - a(3, 1) * a(2, 2);
+            Field c4 = a(2, 1) * a(3, 3) - a(3, 1) * a(2, 3);
+            Field c5 = a(2, 2) * a(3, 3) - a(3, 2) * a(2, 3);
+            Field inv = Field(1) / (s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0);
+            out(0, 0, (a(1, 1) * c5 - a(1, 2) * c4 + a(1, 3) * c3) * inv);
+            out(0, 1, (a(0, 2) * c4 - a(0, 1) * c5 - a(0, 3) * c3) * inv);
+            out(0, 2, (a(3, 1) * s5 - a(3, 2) * s4 + a(3, 3) * s3) * inv);
+            out(0, 3, (a(2, 2) * s4 - a(2, 1) * s5 - a(2, 3) * s3) * inv);
+            out(1, 0, (a(1, 2) * c2 - a(1, 0) * c5 - a(1, 3) * c1) * inv);
+            out(1, 1, (a(0, 0) * c5 - a(0, 2) * c2 + a(0, 3) * c1) * inv);
+            out(1, 2, (a(3, 2) * s2 - a(3, 0) * s5 - a(3, 3) * s1) * inv);
+            out(1, 3, (a(2, 0) * s5 - a(2, 2) * s2 + a(2, 3) * s1) * inv);
+            out(2, 0, (a(1, 0) * c4 - a(1, 1) * c2 + a(1, 3) * c0) * inv);
+            out(2, 1, (a(0, 1) * c2 - a(0, 0) * c4 - a(0, 3) * c0) * inv);
+            out(2, 2, (a(3, 0) * s4 - a(3, 1) * s2 + a(3, 3) * s0) * inv);
+            out(2, 3, (a(2, 1) * s2 - a(2, 0) * s4 - a(2, 3) * s0) * inv);
+            out(3, 0, (a(1, 1) * c1 - a(1, 0) * c3 - a(1, 2) * c0) * inv);
+            out(3, 1, (a(0, 0) * c3 - a(0, 1) * c1 + a(0, 2) * c0) * inv);
+            out(3, 2, (a(3, 1) * s1 - a(3, 0) * s3 - a(3, 2) * s0) * inv);
+            out(3, 3, (a(2, 0) * s3 - a(2, 1) * s1 + a(2, 2) * s0) * inv);
+            return;
         }
     }
+}
 
-    return h;
+template <typename Field>
+Field small_det_kernel(const std::vector<std::vector<Field>>& a, unsigned n) {
+    return small_det<Field>([&a](unsigned i, unsigned j) -> const Field& { return a[i][j]; }, n);
 }
-template <unsigned M, unsigned N, typename Field>
-unsigned Matrix<M, N, Field>::rank() const {
-    unsigned ans = 0;
-    Matrix<M, N, Field> gauss = getGauss();
-    for (unsigned i = 0; i < M; ++i) {
-        for (unsigned j = 0; j < N; ++j) {
-            if (gauss[i][j] != 0) {
-                ++ans;
-                break;
+
+template <typename Field>
+std::vector<std::vector<Field>> small_inverse_kernel(const std::vector<std::vector<Field>>& a, unsigned n) {
+    std::vector<std::vector<Field>> result(n, std::vector<Field>(n));
+    small_inverse<Field>([&a](unsigned i, unsigned j) -> const Field& { return a[i][j]; },
+                         [&result](unsigned i, unsigned j, const Field& x) { result[i][j] = x; }, n);
+    return result;
+}
+
+// PA = LU, computed once and reused: det/rank are O(n), every solve is O(n^2).
+// L (unit diagonal) and U share one table, permutation[i] is the row of A in row i of PA.
+template <typename Field>
+class LUFactorization {
+protected:
+    unsigned n;
+    std::vector<std::vector<Field>> lu;
+    std::vector<unsigned> permutation;
+    unsigned rank_ = 0;
+    bool odd_permutation = false;
+public:
+    LUFactorization(const std::vector<std::vector<Field>>& a, unsigned size);
+
+    Field det() const;
+    unsigned rank() const;
+
+    std::vector<Field> solve(const std::vector<Field>& b) const;
+    std::vector<std::vector<Field>> inverseTable() const;
+};
+
+template <typename Field>
+LUFactorization<Field>::LUFactorization(const std::vector<std::vector<Field>>& a, unsigned size):
+        n(size), lu(a), permutation(size) {
+    for (unsigned i = 0; i < n; ++i) {
+        permutation[i] = i;
+    }
+    for (unsigned J = 0; J < n && rank_ < n; ++J) {
+        unsigned pos = rank_;
+        for (unsigned i = rank_ + 1; i < n; ++i) {
+            if (is_better_pivot(lu[i][J], lu[pos][J]))
+                pos = i;
+        }
+        if (compare_to_zero(lu[pos][J]))
+            continue;
+        if (pos != rank_) {
+            std::swap(lu[pos], lu[rank_]);
+            std::swap(permutation[pos], permutation[rank_]);
+            odd_permutation ^= 1;
+        }
+        for (unsigned i = rank_ + 1; i < n; ++i) {
+            if (compare_to_zero(lu[i][J]))
+                continue;
+            lu[i][J] /= lu[rank_][J];
+            for (unsigned j = J + 1; j < n; ++j) {
+                lu[i][j] -= lu[i][J] * lu[rank_][j];
             }
         }
+        ++rank_;
     }
-    assert(ans <= M && ans <= N);
-    return ans;
 }
 
-template <unsigned M, unsigned N, typename Field>
-Field Matrix<M, N, Field>::det() const {
-    if (M != N) {
-        compilation_error<M == N> a;
-        a = a;
+template <typename Field>
+Field LUFactorization<Field>::det() const {
+    if (rank_ < n)
+        return Field(0);
+    Field res(odd_permutation ? -1 : 1);
+    for (unsigned i = 0; i < n; ++i) {
+        res *= lu[i][i];
     }
+    return res;
+}
 
-    Matrix<M, N, Field> gaussed = getGauss();
-    Field res;
-    res = 1;
-    for (unsigned i = 0; i < M; ++i) {
-        res *= gaussed[i][i];
+template <typename Field>
+unsigned LUFactorization<Field>::rank() const {
+    return rank_;
+}
+
+template <typename Field>
+std::vector<Field> LUFactorization<Field>::solve(const std::vector<Field>& b) const {
+    assert(rank_ == n);
+    std::vector<Field> x(n);
+    for (unsigned i = 0; i < n; ++i) {
+        x[i] = b[permutation[i]];
+        for (unsigned j = 0; j < i; ++j) {
+            x[i] -= lu[i][j] * x[j];
+        }
     }
-    if (res != 0) {
-        bool fl = 1;
-        for (unsigned i = 0; i < M; ++i) {
-            for (unsigned j = 0; j < N; ++j) {
-                if (i != j && gaussed[i][j] != 0) {
-                    fl = 0;
-                    break;
+    for (unsigned i = n; i-- > 0;) {
+        for (unsigned j = i + 1; j < n; ++j) {
+            x[i] -= lu[i][j] * x[j];
+        }
+        x[i] /= lu[i][i];
+    }
+    return x;
+}
+
+template <typename Field>
+std::vector<std::vector<Field>> LUFactorization<Field>::inverseTable() const {
+    std::vector<std::vector<Field>> result(n, std::vector<Field>(n));
+    std::vector<Field> e(n, Field(0));
+    for (unsigned k = 0; k < n; ++k) {
+        e[k] = Field(1);
+        std::vector<Field> x = solve(e);
+        e[k] = Field(0);
+        for (unsigned i = 0; i < n; ++i) {
+            result[i][k] = x[i];
+        }
+    }
+    return result;
+}
+
+// Reduction to upper Hessenberg form by elimination similarities (row i -= c * row k + 1
+// followed by column k + 1 += c * column i), pivoting by row and column swaps. O(n^3) and
+// division only by pivots, so it works over any field. Only exact zeros are skipped: with
+// partial pivoting |c| <= 1 for double, and every entry below the subdiagonal ends at zero.
+template <typename Field>
+void hessenberg_kernel(std::vector<std::vector<Field>>& h, unsigned n) {
+    for (unsigned k = 0; k + 2 < n; ++k) {
+        unsigned pos = k + 1;
+        for (unsigned i = k + 2; i < n; ++i) {
+            if (is_better_pivot(h[i][k], h[pos][k]))
+                pos = i;
+        }
+        if (is_exact_zero(h[pos][k]))
+            continue;
+        if (pos != k + 1) {
+            std::swap(h[pos], h[k + 1]);
+            for (unsigned i = 0; i < n; ++i) {
+                std::swap(h[i][pos], h[i][k + 1]);
+            }
+        }
+        for (unsigned i = k + 2; i < n; ++i) {
+            if (is_exact_zero(h[i][k]))
+                continue;
+            Field con = h[i][k] / h[k + 1][k];
+            for (unsigned j = k + 1; j < n; ++j) {
+                h[i][j] -= h[k + 1][j] * con;
+            }
+            h[i][k] = Field(0);
+            for (unsigned j = 0; j < n; ++j) {
+                h[j][k + 1] += h[j][i] * con;
+            }
+        }
+    }
+}
+
+// det(xI - a), coefficients from x^0 up, via Hessenberg reduction in O(n^3):
+// p_{k+1} = (x - h_kk) p_k - sum_i h_{k-i,k} h_{k,k-1} ... h_{k-i+1,k-i} p_{k-i}
+template <typename Field>
+polynom<Field> charpoly_kernel(std::vector<std::vector<Field>> h, unsigned n) {
+    hessenberg_kernel(h, n);
+    std::vector<polynom<Field>> p(n + 1);
+    p[0] = polynom<Field>(1, Field(1));
+    for (unsigned k = 0; k < n; ++k) {
+        p[k + 1].assign(k + 2, Field(0));
+        for (unsigned j = 0; j <= k; ++j) {
+            p[k + 1][j + 1] += p[k][j];
+            p[k + 1][j] -= p[k][j] * h[k][k];
+        }
+        Field product(1);
+        for (unsigned i = 1; i <= k; ++i) {
+            product *= h[k - i + 1][k - i];
+            Field con = product * h[k - i][k];
+            for (unsigned j = 0; j <= k - i; ++j) {
+                p[k + 1][j] -= p[k - i][j] * con;
+            }
+        }
+    }
+    return p[n];
+}
+
+// Berkowitz: det(xI - a) without any division, for rings such as BigInteger or residues
+// modulo a composite. O(n^4), the characteristic polynomial of every leading principal
+// submatrix is obtained from the previous one by a Toeplitz product.
+template <typename Field>
+polynom<Field> berkowitz_kernel(const std::vector<std::vector<Field>>& a, unsigned n) {
+    // coefficients from the leading one down while building
+    polynom<Field> current(1, Field(1));
+    std::vector<Field> krylov;
+    std::vector<Field> next;
+    for (unsigned r = 0; r < n; ++r) {
+        // column of the Toeplitz matrix: 1, -a_rr, -R C, -R A C, ..., -R A^(r-1) C
+        polynom<Field> toeplitz(r + 2, Field(0));
+        toeplitz[0] = Field(1);
+        toeplitz[1] = Field(0) - a[r][r];
+        krylov.assign(r, Field(0));
+        for (unsigned i = 0; i < r; ++i) {
+            krylov[i] = a[i][r];
+        }
+        for (unsigned k = 0; k < r; ++k) {
+            Field dot(0);
+            for (unsigned i = 0; i < r; ++i) {
+                dot += a[r][i] * krylov[i];
+            }
+            toeplitz[k + 2] = Field(0) - dot;
+            if (k + 1 == r)
+                break;
+            next.assign(r, Field(0));
+            for (unsigned i = 0; i < r; ++i) {
+                for (unsigned j = 0; j < r; ++j) {
+                    next[i] += a[i][j] * krylov[j];
                 }
             }
+            krylov.swap(next);
         }
-        assert(fl);
+        polynom<Field> product(r + 2, Field(0));
+        for (unsigned i = 0; i < r + 2; ++i) {
+            for (unsigned j = 0; j <= std::min(i, r); ++j) {
+                product[i] += toeplitz[i - j] * current[j];
+            }
+        }
+        current.swap(product);
     }
-    return res;
+    std::reverse(current.begin(), current.end());
+    return current;
 }
 
-template <unsigned M, unsigned N, typename Field>
-void Matrix<M, N, Field>::invert() {
+// fraction-free ring: Hessenberg would need exact division
+polynom<BigInteger> charpoly_kernel(const std::vector<std::vector<BigInteger>>& a, unsigned n) {
+    return berkowitz_kernel(a, n);
+}
 
-    if (M != N) {
-        compilation_error<M == N> a;
-        a = a;
+// Rational similarity transforms blow up the numbers, so with A = B / d for an integer
+// matrix B: det(xI - A) = d^-n det(dx I - B) and Berkowitz runs over BigInteger.
+polynom<Rational> charpoly_kernel(const std::vector<std::vector<Rational>>& a, unsigned n) {
+    BigInteger d = 1;
+    for (unsigned i = 0; i < n; ++i) {
+        for (unsigned j = 0; j < n; ++j) {
+            Rational x = a[i][j];
+            x.make_common();
+            d = d / find_gcd(d, x.denominator) * x.denominator;
+        }
     }
-    Matrix<M, M + N, Field> copy;
-    for (unsigned i = 0; i < M; ++i) {
-        copy[i] = core[i];
-        for (unsigned j = 0; j < N; ++j) {
-            copy[i].push_back(Field(0));
+    std::vector<std::vector<BigInteger>> b(n, std::vector<BigInteger>(n));
+    for (unsigned i = 0; i < n; ++i) {
+        for (unsigned j = 0; j < n; ++j) {
+            Rational x = a[i][j];
+            x.make_common();
+            b[i][j] = x.numerator * (d / x.denominator);
         }
-        copy[i][N + i] = 1;
     }
-    Matrix<M, M + N, Field> gaussed = copy.getGauss();
-    for (unsigned i = 0; i < M; ++i) {
-        Field con = gaussed[i][i];
-        for (unsigned j = N; j < 2 * N; ++j) {
-            gaussed[i][j] /= con;
-            core[i][j - N] = gaussed[i][j];
+    polynom<BigInteger> p = berkowitz_kernel(b, n);
+    polynom<Rational> result(n + 1);
+    Rational power = 1;
+    for (unsigned k = n + 1; k-- > 0;) {
+        result[k] = Rational(p[k]) / power;
+        power *= Rational(d);
+    }
+    return result;
+}
+
+template <typename Field>
+void polynom_trim(polynom<Field>& p) {
+    while (!p.empty() && compare_to_zero(p.back())) {
+        p.pop_back();
+    }
+}
+
+// quotient of p by q over a field; p receives the remainder
+template <typename Field>
+polynom<Field> polynom_divide(polynom<Field>& p, const polynom<Field>& q) {
+    polynom_trim(p);
+    if (p.size() < q.size())
+        return polynom<Field>();
+    polynom<Field> quotient(p.size() - q.size() + 1, Field(0));
+    for (unsigned i = quotient.size(); i-- > 0;) {
+        Field con = p[i + q.size() - 1] / q.back();
+        quotient[i] = con;
+        if (compare_to_zero(con))
+            continue;
+        for (unsigned j = 0; j < q.size(); ++j) {
+            p[i + j] -= q[j] * con;
         }
     }
+    p.resize(q.size() - 1);
+    polynom_trim(p);
+    return quotient;
+}
 
+// monic least common multiple of two monic polynomials
+template <typename Field>
+polynom<Field> polynom_lcm(const polynom<Field>& p, const polynom<Field>& q) {
+    polynom<Field> a = p;
+    polynom<Field> b = q;
+    while (!b.empty()) {
+        polynom_divide(a, b);
+        a.swap(b);
+    }
+    Field lead = a.back();
+    for (Field& x : a) {
+        x /= lead;
+    }
+    polynom<Field> rest = p;
+    polynom<Field> quotient = polynom_divide(rest, a);
+    polynom<Field> result(quotient.size() + q.size() - 1, Field(0));
+    for (unsigned i = 0; i < quotient.size(); ++i) {
+        for (unsigned j = 0; j < q.size(); ++j) {
+            result[i + j] += quotient[i] * q[j];
+        }
+    }
+    return result;
 }
 
-template <unsigned M, unsigned N, typename Field>
-Matrix<M, N, Field> Matrix<M, N, Field>::inverted() const {
-    Matrix<M, N, Field> result = *this;
-    result.invert();
+// Minimal polynomial over a field, coefficients from x^0 up: the lcm of the minimal
+// polynomials of the unit vectors, each found by reducing its Krylov sequence
+// v, Av, A^2 v, ... until it becomes dependent. Vectors already annihilated by the
+// current lcm are skipped, so usually only a few sequences are built.
+template <typename Field>
+polynom<Field> minpoly_kernel(const std::vector<std::vector<Field>>& a, unsigned n) {
+    polynom<Field> result(1, Field(1));
+    std::vector<Field> v(n);
+    std::vector<Field> w(n);
+    for (unsigned e = 0; e < n && result.size() <= n; ++e) {
+        // result(a) applied to the unit vector, by Horner's rule
+        std::fill(v.begin(), v.end(), Field(0));
+        for (unsigned k = result.size(); k-- > 0;) {
+            std::fill(w.begin(), w.end(), Field(0));
+            for (unsigned i = 0; i < n; ++i) {
+                for (unsigned j = 0; j < n; ++j) {
+                    w[i] += a[i][j] * v[j];
+                }
+            }
+            w[e] += result[k];
+            v.swap(w);
+        }
+        bool annihilated = true;
+        for (unsigned i = 0; i < n; ++i) {
+            annihilated &= compare_to_zero(v[i]);
+        }
+        if (annihilated)
+            continue;
+        // echelon basis of the sequence so far, each row with the polynomial it came from
+        std::vector<std::vector<Field>> basis;
+        std::vector<polynom<Field>> origin;
+        std::vector<unsigned> pivots;
+        std::fill(v.begin(), v.end(), Field(0));
+        v[e] = Field(1);
+        for (unsigned degree = 0;; ++degree) {
+            std::vector<Field> row = v;
+            polynom<Field> poly(degree + 1, Field(0));
+            poly[degree] = Field(1);
+            for (unsigned b = 0; b < basis.size(); ++b) {
+                if (compare_to_zero(row[pivots[b]]))
+                    continue;
+                Field con = row[pivots[b]] / basis[b][pivots[b]];
+                for (unsigned j = 0; j < n; ++j) {
+                    row[j] -= basis[b][j] * con;
+                }
+                for (unsigned j = 0; j < origin[b].size(); ++j) {
+                    poly[j] -= origin[b][j] * con;
+                }
+            }
+            unsigned pivot = 0;
+            while (pivot < n && compare_to_zero(row[pivot])) {
+                ++pivot;
+            }
+            if (pivot == n) {
+                result = polynom_lcm(result, poly);
+                break;
+            }
+            basis.push_back(row);
+            origin.push_back(poly);
+            pivots.push_back(pivot);
+            std::fill(w.begin(), w.end(), Field(0));
+            for (unsigned i = 0; i < n; ++i) {
+                for (unsigned j = 0; j < n; ++j) {
+                    w[i] += a[i][j] * v[j];
+                }
+            }
+            v.swap(w);
+        }
+    }
     return result;
 }
+
+// Eigenvalues of a real matrix: Hessenberg reduction, then single-shift QR iteration in
+// complex arithmetic with Wilkinson shifts and deflation of negligible subdiagonal entries.
+// Each QR step on the Hessenberg form costs O(n^2) Givens work, O(n^3) in total. If a
+// block is still not split after 100 n steps the iteration stops, and fewer than n values
+// are returned.
+std::vector<complex> eigenvalues_kernel(std::vector<std::vector<double>> a, unsigned n) {
+    hessenberg_kernel(a, n);
+    std::vector<std::vector<complex>> h(n, std::vector<complex>(n));
+    double norm = 0;
+    for (unsigned i = 0; i < n; ++i) {
+        for (unsigned j = 0; j < n; ++j) {
+            h[i][j] = a[i][j];
+            norm = std::max(norm, std::abs(a[i][j]));
+        }
+    }
+    const double precision = std::numeric_limits<double>::epsilon();
+    std::vector<complex> result;
+    std::vector<complex> cosines(n);
+    std::vector<complex> sines(n);
+    unsigned iterations = 0;
+    for (int hi = static_cast<int>(n) - 1; hi >= 0;) {
+        int lo = hi;
+        while (lo > 0) {
+            double scale = std::abs(h[lo][lo]) + std::abs(h[lo - 1][lo - 1]);
+            if (scale == 0)
+                scale = norm;
+            if (std::abs(h[lo][lo - 1]) <= precision * scale) {
+                h[lo][lo - 1] = 0;
+                break;
+            }
+            --lo;
+        }
+        if (lo == hi) {
+            result.push_back(h[hi][hi]);
+            --hi;
+            iterations = 0;
+            continue;
+        }
+        if (++iterations >= 100 * n)
+            break;
+        // eigenvalue of the trailing 2x2 block closer to its last diagonal entry
+        complex a11 = h[hi - 1][hi - 1];
+        complex a22 = h[hi][hi];
+        complex half_trace = (a11 + a22) / 2.0;
+        complex root = std::sqrt((a11 - a22) * (a11 - a22) / 4.0 + h[hi - 1][hi] * h[hi][hi - 1]);
+        complex shift = std::abs(half_trace + root - a22) < std::abs(half_trace - root - a22) ?
+                half_trace + root : half_trace - root;
+        // exceptional shift against cycling
+        if (iterations % 10 == 0)
+            shift = a22 + std::abs(h[hi][hi - 1]);
+        for (int k = lo; k <= hi; ++k) {
+            h[k][k] -= shift;
+        }
+        // H - shift = QR by Givens rotations, then H = RQ + shift
+        for (int k = lo; k < hi; ++k) {
+            double r = std::hypot(std::abs(h[k][k]), std::abs(h[k + 1][k]));
+            complex c = r == 0 ? complex(1) : h[k][k] / r;
+            complex s = r == 0 ? complex(0) : h[k + 1][k] / r;
+            cosines[k] = c;
+            sines[k] = s;
+            for (int j = k; j <= hi; ++j) {
+                complex x = h[k][j];
+                complex y = h[k + 1][j];
+                h[k][j] = std::conj(c) * x + std::conj(s) * y;
+                h[k + 1][j] = c * y - s * x;
+            }
+        }
+        for (int k = lo; k < hi; ++k) {
+            complex c = cosines[k];
+            complex s = sines[k];
+            for (int i = lo; i <= k + 1; ++i) {
+                complex x = h[i][k];
+                complex y = h[i][k + 1];
+                h[i][k] = x * c + y * s;
+                h[i][k + 1] = y * std::conj(c) - x * std::conj(s);
+            }
+        }
+        for (int k = lo; k <= hi; ++k) {
+            h[k][k] += shift;
+        }
+    }
+    return result;
+}
+
+// Fraction-free (Bareiss) elimination to row echelon form: every entry stays an integer
+// minor of the input, so the divisions are exact and no gcd is ever taken. Returns the
+// rank; sign receives the sign of det when rows == cols.
+unsigned bareiss_kernel(std::vector<std::vector<BigInteger>>& h, unsigned rows, unsigned cols, int& sign) {
+    BigInteger previous = 1;
+    unsigned place = 0;
+    sign = 1;
+    for (unsigned J = 0; J < cols && place < rows; ++J) {
+        unsigned pos = place;
+        while (pos < rows && h[pos][J] == 0) {
+            ++pos;
+        }
+        if (pos == rows)
+            continue;
+        if (pos != place) {
+            std::swap(h[pos], h[place]);
+            sign = -sign;
+        }
+        const std::vector<BigInteger>& pivot_row = h[place];
+        for (unsigned i = place + 1; i < rows; ++i) {
+            for (unsigned j = J + 1; j < cols; ++j) {
+                h[i][j] = (h[i][j] * pivot_row[J] - h[i][J] * pivot_row[j]) / previous;
+            }
+            h[i][J] = 0;
+        }
+        previous = pivot_row[J];
+        ++place;
+    }
+    if (place == rows && rows == cols && previous < 0)
+        sign = -sign;
+    return place;
+}
+
+template <typename Field>
+Field det_kernel(const std::vector<std::vector<Field>>& a, unsigned n) {
+    if (n == 0)
+        return Field(1);
+    if (n <= 4)
+        return small_det_kernel(a, n);
+    return LUFactorization<Field>(a, n).det();
+}
+
+// BigInteger is a ring: LU would truncate its divisions, Bareiss divides only exactly
+BigInteger det_kernel(const std::vector<std::vector<BigInteger>>& a, unsigned n) {
+    if (n == 0)
+        return 1;
+    std::vector<std::vector<BigInteger>> h = a;
+    int sign = 1;
+    if (bareiss_kernel(h, n, n, sign) < n)
+        return 0;
+    // the last pivot is det up to sign
+    BigInteger last = h[n - 1][n - 1].abs();
+    return sign < 0 ? -last : last;
+}
+
+template <typename Field>
+unsigned rank_kernel(const std::vector<std::vector<Field>>& a, unsigned rows, unsigned cols) {
+    std::vector<std::vector<Field>> h = a;
+    return gauss_kernel(h, rows, cols, false);
+}
+
+unsigned rank_kernel(const std::vector<std::vector<BigInteger>>& a, unsigned rows, unsigned cols) {
+    std::vector<std::vector<BigInteger>> h = a;
+    int sign = 1;
+    return bareiss_kernel(h, rows, cols, sign);
+}
+
+// Solves a x = b for a square nonsingular a and k right-hand sides at once: forward
+// elimination with partial pivoting and back substitution on [a | b] in place, without
+// forming the inverse. Returns x, which reuses the storage of b.
+template <typename Field>
+std::vector<std::vector<Field>> solve_kernel(std::vector<std::vector<Field>> a, std::vector<std::vector<Field>> b,
+                                             unsigned n, unsigned k) {
+    for (unsigned J = 0; J < n; ++J) {
+        unsigned pos = J;
+        for (unsigned i = J + 1; i < n; ++i) {
+            if (is_better_pivot(a[i][J], a[pos][J]))
+                pos = i;
+        }
+        assert(!compare_to_zero(a[pos][J]));
+        if (pos != J) {
+            std::swap(a[pos], a[J]);
+            std::swap(b[pos], b[J]);
+        }
+        for (unsigned i = J + 1; i < n; ++i) {
+            if (compare_to_zero(a[i][J]))
+                continue;
+            Field con = a[i][J] / a[J][J];
+            for (unsigned j = J + 1; j < n; ++j) {
+                a[i][j] -= a[J][j] * con;
+            }
+            for (unsigned j = 0; j < k; ++j) {
+                b[i][j] -= b[J][j] * con;
+            }
+            a[i][J] = Field(0);
+        }
+    }
+    for (unsigned i = n; i-- > 0;) {
+        for (unsigned j = i + 1; j < n; ++j) {
+            if (compare_to_zero(a[i][j]))
+                continue;
+            for (unsigned t = 0; t < k; ++t) {
+                b[i][t] -= a[i][j] * b[j][t];
+            }
+        }
+        for (unsigned t = 0; t < k; ++t) {
+            b[i][t] /= a[i][i];
+        }
+    }
+    return b;
+}
+
+// Inverse of a modulo a prime p < 2^31 by Gauss-Jordan on raw 64-bit values; false if a
+// is singular modulo p.
+bool inverse_mod_kernel(const std::vector<std::vector<long long>>& a, unsigned n, uint64_t p,
+                        std::vector<std::vector<uint64_t>>& inverse) {
+    std::vector<std::vector<uint64_t>> h(n, std::vector<uint64_t>(2 * n, 0));
+    for (unsigned i = 0; i < n; ++i) {
+        for (unsigned j = 0; j < n; ++j) {
+            long long x = a[i][j] % static_cast<long long>(p);
+            h[i][j] = x < 0 ? x + p : x;
+        }
+        h[i][n + i] = 1;
+    }
+    for (unsigned J = 0; J < n; ++J) {
+        unsigned pos = J;
+        while (pos < n && h[pos][J] == 0) {
+            ++pos;
+        }
+        if (pos == n)
+            return false;
+        std::swap(h[pos], h[J]);
+        // Fermat: h^(p - 2) is the inverse
+        uint64_t inv = 1;
+        uint64_t base = h[J][J];
+        for (uint64_t e = p - 2; e > 0; e >>= 1) {
+            if (e & 1)
+                inv = inv * base % p;
+            base = base * base % p;
+        }
+        for (unsigned j = J; j < 2 * n; ++j) {
+            h[J][j] = h[J][j] * inv % p;
+        }
+        for (unsigned i = 0; i < n; ++i) {
+            if (i == J || h[i][J] == 0)
+                continue;
+            uint64_t con = p - h[i][J];
+            for (unsigned j = J; j < 2 * n; ++j) {
+                h[i][j] = (h[i][j] + con * h[J][j]) % p;
+            }
+        }
+    }
+    inverse.assign(n, std::vector<uint64_t>(n));
+    for (unsigned i = 0; i < n; ++i) {
+        std::copy(h[i].begin() + n, h[i].end(), inverse[i].begin());
+    }
+    return true;
+}
+
+// Finds num / den = u modulo m with |num|, den <= bound by the extended Euclidean algorithm;
+// unique when 2 bound^2 < m.
+bool rational_reconstruction(const BigInteger& u, const BigInteger& m, const BigInteger& bound,
+                             BigInteger& num, BigInteger& den) {
+    BigInteger r0 = m;
+    BigInteger r1 = u;
+    if (r1 < 0)
+        r1 += m;
+    BigInteger s0 = 0;
+    BigInteger s1 = 1;
+    while (r1 > bound) {
+        // quotients are almost always tiny: subtract before paying for a long division
+        for (int q = 0; q < 4 && r0 >= r1; ++q) {
+            r0 -= r1;
+            s0 -= s1;
+        }
+        if (r0 >= r1) {
+            BigInteger q = r0 / r1;
+            r0 -= q * r1;
+            s0 -= q * s1;
+        }
+        std::swap(r0, r1);
+        std::swap(s0, s1);
+    }
+    if (s1 == 0 || s1.abs() > bound)
+        return false;
+    num = s1 < 0 ? -r1 : r1;
+    den = s1.abs();
+    return true;
+}
+
+// Dixon p-adic lifting for an integer system a x = b with |a| < 2^31 and |b| < 2^62.
+// With C = a^-1 mod p, every step takes the next p-adic digit x_i = C r_i mod p and the
+// residual r_{i+1} = (r_i - a x_i) / p, which stays below n 2^31 + 1, so all lifting runs
+// in machine integers in O(n^2 k) per step, and x = sum x_i p^i mod p^L. The rational
+// solution is reconstructed from x when the number of steps doubles and accepted only if
+// it satisfies a x = b exactly; the Hadamard bound caps the number of steps. Rational Gauss
+// instead pays for numbers that grow with every elimination step. Returns false when
+// a is singular modulo all the primes tried.
+bool dixon_solve(const std::vector<std::vector<long long>>& a, const std::vector<std::vector<long long>>& b,
+                 unsigned n, unsigned k, std::vector<std::vector<Rational>>& x) {
+    const uint64_t primes[] = {2147483647, 2147483629, 2147483587};
+    uint64_t p = 0;
+    std::vector<std::vector<uint64_t>> inverse;
+    for (uint64_t candidate : primes) {
+        if (inverse_mod_kernel(a, n, candidate, inverse)) {
+            p = candidate;
+            break;
+        }
+    }
+    if (p == 0)
+        return false;
+    // Hadamard: numerators and denominators of x are at most the product of the row norms of [a | b]
+    double hadamard_bits = 0;
+    for (unsigned i = 0; i < n; ++i) {
+        double norm = 0;
+        for (long long v : a[i]) {
+            norm += static_cast<double>(v) * v;
+        }
+        double largest = 0;
+        for (long long v : b[i]) {
+            largest = std::max(largest, static_cast<double>(v) * v);
+        }
+        hadamard_bits += std::log2(std::max(norm + largest, 1.0)) / 2;
+    }
+    // p^L > 2 bound^2 with bound = p^((L - 1) / 2)
+    unsigned max_steps = 2 * static_cast<unsigned>(std::ceil((hadamard_bits + 1) / std::log2(p))) + 3;
+
+    typedef __int128 wide;
+    std::vector<std::vector<wide>> residual(n, std::vector<wide>(k));
+    for (unsigned i = 0; i < n; ++i) {
+        for (unsigned t = 0; t < k; ++t) {
+            residual[i][t] = b[i][t];
+        }
+    }
+    std::vector<std::vector<std::vector<uint64_t>>> digits;
+    std::vector<std::vector<uint64_t>> r(n, std::vector<uint64_t>(k));
+    unsigned check_at = 4;
+    for (unsigned step = 1; step <= max_steps; ++step) {
+        for (unsigned i = 0; i < n; ++i) {
+            for (unsigned t = 0; t < k; ++t) {
+                wide v = residual[i][t] % static_cast<wide>(p);
+                r[i][t] = v < 0 ? v + p : v;
+            }
+        }
+        std::vector<std::vector<uint64_t>> digit(n, std::vector<uint64_t>(k, 0));
+        for (unsigned i = 0; i < n; ++i) {
+            for (unsigned j = 0; j < n; ++j) {
+                uint64_t c = inverse[i][j];
+                if (c == 0)
+                    continue;
+                for (unsigned t = 0; t < k; ++t) {
+                    digit[i][t] = (digit[i][t] + c * r[j][t]) % p;
+                }
+            }
+        }
+        for (unsigned i = 0; i < n; ++i) {
+            for (unsigned j = 0; j < n; ++j) {
+                if (a[i][j] == 0)
+                    continue;
+                for (unsigned t = 0; t < k; ++t) {
+                    residual[i][t] -= static_cast<wide>(a[i][j]) * static_cast<wide>(digit[j][t]);
+                }
+            }
+            for (unsigned t = 0; t < k; ++t) {
+                residual[i][t] /= static_cast<wide>(p);
+            }
+        }
+        digits.push_back(digit);
+        if (step != check_at && step != max_steps)
+            continue;
+        check_at *= 2;
+
+        BigInteger modulus = 1;
+        BigInteger bound = 1;
+        BigInteger prime = static_cast<long long>(p);
+        for (unsigned i = 0; i < step; ++i) {
+            modulus *= prime;
+            // bound = p^((step - 1) / 2), so that 2 bound^2 < p^step also for even step
+            if (2 * i + 2 < step)
+                bound *= prime;
+        }
+        // common denominator: most entries need only a multiplication, not a reconstruction
+        BigInteger common = 1;
+        std::vector<std::vector<BigInteger>> numerators(n, std::vector<BigInteger>(k));
+        bool reconstructed = true;
+        for (unsigned i = 0; i < n && reconstructed; ++i) {
+            for (unsigned t = 0; t < k && reconstructed; ++t) {
+                BigInteger u = 0;
+                for (unsigned l = step; l-- > 0;) {
+                    u = u * prime + BigInteger(static_cast<long long>(digits[l][i][t]));
+                }
+                BigInteger y = u * common % modulus;
+                if (y < 0)
+                    y += modulus;
+                if (y * 2 > modulus)
+                    y -= modulus;
+                if (y.abs() <= bound) {
+                    numerators[i][t] = y;
+                    continue;
+                }
+                BigInteger num;
+                BigInteger den;
+                reconstructed = rational_reconstruction(y, modulus, bound, num, den);
+                if (!reconstructed)
+                    break;
+                for (unsigned i1 = 0; i1 <= i; ++i1) {
+                    for (unsigned t1 = 0; t1 < (i1 < i ? k : t); ++t1) {
+                        numerators[i1][t1] *= den;
+                    }
+                }
+                numerators[i][t] = num;
+                common *= den;
+                // the true common denominator is within the bound, too few digits otherwise
+                reconstructed = common <= bound;
+            }
+        }
+        if (!reconstructed)
+            continue;
+        bool verified = true;
+        for (unsigned i = 0; i < n && verified; ++i) {
+            for (unsigned t = 0; t < k && verified; ++t) {
+                BigInteger sum = 0;
+                for (unsigned j = 0; j < n; ++j) {
+                    if (a[i][j] != 0)
+                        sum += numerators[j][t] * BigInteger(a[i][j]);
+                }
+                verified = sum == common * BigInteger(b[i][t]);
+            }
+        }
+        if (!verified)
+            continue;
+        x.assign(n, std::vector<Rational>(k));
+        for (unsigned i = 0; i < n; ++i) {
+            for (unsigned t = 0; t < k; ++t) {
+                x[i][t].numerator = numerators[i][t];
+                x[i][t].denominator = common;
+                x[i][t].make_common();
+            }
+        }
+        return true;
+    }
+    return false;
+}
+
+// Rational systems: every row of [a | b] is scaled by the lcm of its denominators, and if
+// the integers are small enough for Dixon lifting it replaces Rational Gauss.
+std::vector<std::vector<Rational>> solve_kernel(std::vector<std::vector<Rational>> a, std::vector<std::vector<Rational>> b,
+                                                unsigned n, unsigned k) {
+    std::vector<std::vector<long long>> a_int(n, std::vector<long long>(n));
+    std::vector<std::vector<long long>> b_int(n, std::vector<long long>(k));
+    const BigInteger a_limit = 1LL << 31;
+    const BigInteger b_limit = 1LL << 62;
+    bool small = true;
+    for (unsigned i = 0; i < n && small; ++i) {
+        BigInteger d = 1;
+        for (unsigned j = 0; j < n + k; ++j) {
+            Rational& v = j < n ? a[i][j] : b[i][j - n];
+            v.make_common();
+            d = d / find_gcd(d, v.denominator) * v.denominator;
+        }
+        for (unsigned j = 0; j < n + k && small; ++j) {
+            const Rational& v = j < n ? a[i][j] : b[i][j - n];
+            BigInteger scaled = v.numerator * (d / v.denominator);
+            small = scaled.abs() < (j < n ? a_limit : b_limit);
+            if (!small)
+                break;
+            long long value = 0;
+            for (size_t l = scaled.size(); l-- > 0;) {
+                value = value * BigInteger::radix + scaled[l];
+            }
+            (j < n ? a_int[i][j] : b_int[i][j - n]) = scaled.sign() ? -value : value;
+        }
+    }
+    std::vector<std::vector<Rational>> x;
+    if (small && dixon_solve(a_int, b_int, n, k, x))
+        return x;
+    return solve_kernel<Rational>(a, b, n, k);
+}
+
+template <unsigned M, unsigned N, typename Field>
+class Matrix;
+
+template <typename Field>
+class DynamicMatrix;
+
+// Lazy element-wise expressions: operators only build a tree, and the tree is evaluated
+// in a single pass over the destination on assignment, construction or eval().
+template <typename E>
+class MatrixTransposed;
+
+template <typename E>
+class MatrixExpression {
+public:
+    const E& self() const {
+        return static_cast<const E&>(*this);
+    }
+    auto eval() const {
+        return Matrix<E::rows, E::cols, typename E::field_type>(self());
+    }
+    MatrixTransposed<E> transposedView() const {
+        return MatrixTransposed<E>(self());
+    }
+};
+
+// matrices are held by reference, intermediate expression nodes by value
+template <typename E>
+struct expression_operand {
+    using type = const E;
+};
+
+template <unsigned M, unsigned N, typename Field>
+struct expression_operand<Matrix<M, N, Field>> {
+    using type = const Matrix<M, N, Field>&;
+};
+
+template <typename L, typename R, bool is_dif>
+class MatrixSum: public MatrixExpression<MatrixSum<L, R, is_dif>> {
+private:
+    typename expression_operand<L>::type left;
+    typename expression_operand<R>::type right;
+public:
+    static const unsigned rows = L::rows;
+    static const unsigned cols = L::cols;
+    static const bool elementwise = L::elementwise && R::elementwise;
+    using field_type = typename L::field_type;
+
+    MatrixSum(const L& l, const R& r): left(l), right(r) {}
+
+    field_type at(unsigned i, unsigned j) const {
+        return is_dif ? left.at(i, j) - right.at(i, j) : left.at(i, j) + right.at(i, j);
+    }
+};
+
+template <typename E>
+class MatrixScaled: public MatrixExpression<MatrixScaled<E>> {
+public:
+    static const unsigned rows = E::rows;
+    static const unsigned cols = E::cols;
+    static const bool elementwise = E::elementwise;
+    using field_type = typename E::field_type;
+private:
+    typename expression_operand<E>::type expression;
+    field_type scalar;
+public:
+    MatrixScaled(const E& e, const field_type& k): expression(e), scalar(k) {}
+
+    field_type at(unsigned i, unsigned j) const {
+        return expression.at(i, j) * scalar;
+    }
+};
+
+// zero-cost transposed view; (i, j) reads (j, i) of the operand, so it is not element-wise
+// and assigning it over its own operand goes through a temporary
+template <typename E>
+class MatrixTransposed: public MatrixExpression<MatrixTransposed<E>> {
+private:
+    typename expression_operand<E>::type expression;
+public:
+    static const unsigned rows = E::cols;
+    static const unsigned cols = E::rows;
+    static const bool elementwise = false;
+    using field_type = typename E::field_type;
+
+    explicit MatrixTransposed(const E& e): expression(e) {}
+
+    const E& base() const {
+        return expression;
+    }
+
+    field_type at(unsigned i, unsigned j) const {
+        return expression.at(j, i);
+    }
+};
+
+template <typename L, typename R>
+MatrixSum<L, R, false> operator+(const MatrixExpression<L>& a, const MatrixExpression<R>& b) {
+    compilation_error<L::rows == R::rows && L::cols == R::cols> check;
+    check = check;
+    return MatrixSum<L, R, false>(a.self(), b.self());
+}
+
+template <typename L, typename R>
+MatrixSum<L, R, true> operator-(const MatrixExpression<L>& a, const MatrixExpression<R>& b) {
+    compilation_error<L::rows == R::rows && L::cols == R::cols> check;
+    check = check;
+    return MatrixSum<L, R, true>(a.self(), b.self());
+}
+
+template <typename E>
+MatrixScaled<E> operator*(const MatrixExpression<E>& a, const typename E::field_type& k) {
+    return MatrixScaled<E>(a.self(), k);
+}
+
+template <typename E>
+MatrixScaled<E> operator*(const typename E::field_type& k, const MatrixExpression<E>& a) {
+    return MatrixScaled<E>(a.self(), k);
+}
+
+template <unsigned M, unsigned N, typename Field = Rational>
+class Matrix: public MatrixExpression<Matrix<M, N, Field>> {
+template <unsigned M1, unsigned N1, unsigned K, typename Field1>
+friend Matrix<M1, N1, Field1> strassen(const Matrix<M1, K, Field1>& a, const Matrix<K, N1, Field1>& b);
+template <unsigned M1, unsigned N1, unsigned K, typename Field1>
+friend Matrix<M1, N1, Field1> operator*(const Matrix<M1, K, Field1>& a, const Matrix<K, N1, Field1>& b);
+template <unsigned M1, unsigned N1, unsigned K, typename Field1>
+friend Matrix<M1, N1, Field1> operator*(const MatrixTransposed<Matrix<K, M1, Field1>>& a, const Matrix<K, N1, Field1>& b);
+template <unsigned M1, unsigned N1, typename Field1>
+friend class Matrix;
+template <typename Field1>
+friend class DynamicMatrix;
+template <unsigned N1, typename Field1>
+friend class LU;
+private:
+    std::vector < std::vector < Field > > core;//(M, std::vector<Field>(N));
+public:
+    Matrix() {
+        core.resize(M);
+        for (unsigned i = 0; i < M; ++i) {
+            core[i].resize(N);
+        }
+    }
+
+    Matrix(const std::initializer_list<std::vector<int>> &I){
+        core.resize(M);
+        int it = 0;
+        for (auto &i : I) {
+            core[it].resize(N);
+            for (unsigned j = 0; j < i.size(); ++j) {
+                core[it][j] = Field(i[j]);
+            }
+            ++it;
+        }
+    }
+    Matrix(const std::initializer_list<std::initializer_list<int>> &I){
+        core.resize(M);
+        int it = 0;
+        for (auto &i : I) {
+            core[it].resize(N);
+            int it2 = 0;
+            for (auto &j : i) {
+                core[it][it2] = Field(j);
+                ++it2;
+            }
+            ++it;
+        }
+    }
+    Matrix(const std::vector < std::vector < int > > &I) {
+        core.resize(M);
+        int it = 0;
+        for (auto &i : I) {
+            core[it].resize(N);
+            for (size_t j = 0; j < i.size(); ++j) {
+                core[it][j] = Field(i[j]);
+            }
+            ++it;
+        }
+    }
+    Matrix(const std::vector < std::vector < Field > > &I) {
+        core.resize(M);
+        int it = 0;
+        for (auto &i : I) {
+            core[it].resize(N);
+            for (size_t j = 0; j < i.size(); ++j) {
+                core[it][j] = i[j];
+            }
+            ++it;
+        }
+    }
+    Matrix(const Matrix& a) {
+        core.resize(M);
+        for (unsigned i = 0; i < M; ++i) {
+            core[i].resize(N);
+            for (unsigned j = 0; j < N; ++j) {
+                core[i][j] = a.core[i][j];
+            }
+        }
+    }
+    template <typename E>
+    Matrix(const MatrixExpression<E>& e) {
+        compilation_error<E::rows == M && E::cols == N> check;
+        check = check;
+        core.resize(M);
+        for (unsigned i = 0; i < M; ++i) {
+            core[i].resize(N);
+            for (unsigned j = 0; j < N; ++j) {
+                core[i][j] = e.self().at(i, j);
+            }
+        }
+    }
+
+    static const unsigned rows = M;
+    static const unsigned cols = N;
+    static const bool elementwise = true;
+    using field_type = Field;
+
+    const Field& at(unsigned i, unsigned j) const {
+        return core[i][j];
+    }
+
+    Matrix<M, N, Field>& operator=(const Matrix<M, N, Field>&);//
+    template <typename E>
+    Matrix<M, N, Field>& operator=(const MatrixExpression<E>&);
+    template <typename E>
+    Matrix<M, N, Field>& operator+=(const MatrixExpression<E>&);//
+    template <typename E>
+    Matrix<M, N, Field>& operator-=(const MatrixExpression<E>&);//
+    Matrix<M, N, Field>& operator*=(const Field&);//
+
+    Matrix<N, M, Field> transposed() const;//
+    void transpose();
+    Matrix<M, N, Field> getGauss() const;//
+    unsigned rank() const;//
+
+    std::vector<Field> getRow(unsigned) const;//
+    std::vector<Field> getColumn(unsigned) const;//
+
+    std::vector<Field>& operator[](unsigned);//
+    std::vector<Field> operator[](unsigned) const;//
+
+//squared:
+    Matrix<M, N, Field>& operator*=(Matrix<M, N, Field>& a);
+    Matrix<M, N, Field> pow(unsigned long long k) const;
+    Field det() const;//
+    Matrix<M, N, Field> inverted() const;
+    void invert();
+    Field trace() const;//
+    polynom<Field> charpoly() const;
+    polynom<Field> minpoly() const;
+    template <unsigned K>
+    Matrix<N, K, Field> solve(const Matrix<M, K, Field>& b) const;
+};
+
+template <unsigned M, unsigned N, unsigned K, typename Field>
+Matrix<M, N, Field> operator*(const Matrix<M, K, Field>&, const Matrix<K, N, Field>&);//
+
+template <typename L, typename R>
+bool operator==(const MatrixExpression<L>&, const MatrixExpression<R>&);//
+
+template <typename L, typename R>
+bool operator!=(const MatrixExpression<L>&, const MatrixExpression<R>&);//
+
+template <unsigned N, typename Field = Rational>
+using SquareMatrix = Matrix<N, N, Field>;
+
+
+
+//---------------------------------------------------------------------------------------------------------------------------------------
+
+
+template<unsigned M, unsigned N, typename Field>
+Matrix<M, N, Field>& Matrix<M, N, Field>::operator=(const Matrix<M, N, Field>& a) {
+    core = a.core;
+    return *this;
+}
+
+template<unsigned M, unsigned N, typename Field>
+template <typename E>
+Matrix<M, N, Field>& Matrix<M, N, Field>::operator=(const MatrixExpression<E>& a) {
+    compilation_error<E::rows == M && E::cols == N> check;
+    check = check;
+    if (!E::elementwise) {
+        Matrix<M, N, Field> evaluated(a);
+        return *this = evaluated;
+    }
+    for (unsigned i = 0; i < M; ++i) {
+        std::vector<Field>& row = core[i];
+        for (unsigned j = 0; j < N; ++j) {
+            row[j] = a.self().at(i, j);
+        }
+    }
+    return *this;
+}
+
+template<unsigned M, unsigned N, typename Field>
+template <typename E>
+Matrix<M, N, Field>& Matrix<M, N, Field>::operator+=(const MatrixExpression<E>& a) {
+    compilation_error<E::rows == M && E::cols == N> check;
+    check = check;
+    if (!E::elementwise) {
+        Matrix<M, N, Field> evaluated(a);
+        return *this += evaluated;
+    }
+    for (unsigned i = 0; i < M; ++i) {
+        std::vector<Field>& row = core[i];
+        for (unsigned j = 0; j < N; ++j) {
+            row[j] += a.self().at(i, j);
+        }
+    }
+    return *this;
+}
+
+template<unsigned M, unsigned N, typename Field>
+template <typename E>
+Matrix<M, N, Field>& Matrix<M, N, Field>::operator-=(const MatrixExpression<E>& a) {
+    compilation_error<E::rows == M && E::cols == N> check;
+    check = check;
+    if (!E::elementwise) {
+        Matrix<M, N, Field> evaluated(a);
+        return *this -= evaluated;
+    }
+    for (unsigned i = 0; i < M; ++i) {
+        std::vector<Field>& row = core[i];
+        for (unsigned j = 0; j < N; ++j) {
+            row[j] -= a.self().at(i, j);
+        }
+    }
+    return *this;
+}
+
+template <typename L, typename R>
+bool operator==(const MatrixExpression<L>& a, const MatrixExpression<R>& b) {
+    if (L::rows != R::rows || L::cols != R::cols)
+        return false;
+
+    for (unsigned i = 0; i < L::rows; ++i) {
+        for (unsigned j = 0; j < L::cols; ++j) {
+            if (a.self().at(i, j) != b.self().at(i, j))
+                return false;
+        }
+    }
+    return true;
+}
+
+template <typename L, typename R>
+bool operator!=(const MatrixExpression<L>& a, const MatrixExpression<R>& b) {
+    return !(a == b);
+}
+
+template<unsigned M, unsigned N, typename Field>
+Matrix<M, N, Field>& Matrix<M, N, Field>::operator*=(const Field& a) {
+    for (unsigned i = 0; i < M; ++i) {
+        for (unsigned j = 0; j < N; ++j) {
+            core[i][j] *= a;
+        }
+    }
+    return *this;
+}
+
+
+
+template<unsigned M, unsigned N, typename Field>
+Matrix<N, M, Field> Matrix<M, N, Field>::transposed() const {
+    Matrix<N, M, Field> res;
+    transpose_kernel(core, res.core, M, N);
+    return res;
+}
+template<unsigned M, unsigned N, typename Field>
+void Matrix<M, N, Field>::transpose() {
+    if (M != N) {
+        compilation_error<M == N> a;
+        a = a;
+    }
+    transpose_in_place_kernel(core, 0, M);
+}
+
+template<unsigned M, unsigned N, typename Field>
+std::vector < Field > Matrix<M, N, Field>::getRow(unsigned i) const {
+    return (*this)[i];
+}
+
+template<unsigned M, unsigned N, typename Field>
+std::vector < Field > Matrix<M, N, Field>::getColumn(unsigned i) const {
+    std::vector < Field > res(M);
+    for (unsigned j = 0; j < M; ++j) {
+        res[j] = core[j][i];
+    }
+    return res;
+}
+template <unsigned M, unsigned N, typename Field>
+std::vector<Field>& Matrix<M, N, Field>::operator[](unsigned i) {
+    return core[i];
+}
+template <unsigned M, unsigned N, typename Field>
+std::vector<Field> Matrix<M, N, Field>::operator[](unsigned i) const {
+    return core[i];
+}
+template <unsigned M, unsigned N, typename Field>
+Field Matrix<M, N, Field>::trace() const {
+    if (M != N) {
+        compilation_error<M == N> a;
+        a = a;
+    }
+    Field res;
+    res = 0;
+    for (unsigned i = 0; i < M; ++i) {
+        res += core[i][i];
+    }
+    return res;
+}
+
+// det(xI - A), coefficients from x^0 up
+template <unsigned M, unsigned N, typename Field>
+polynom<Field> Matrix<M, N, Field>::charpoly() const {
+    if (M != N) {
+        compilation_error<M == N> a;
+        a = a;
+    }
+    return charpoly_kernel(core, M);
+}
+template <unsigned M, unsigned N, typename Field>
+polynom<Field> Matrix<M, N, Field>::minpoly() const {
+    if (M != N) {
+        compilation_error<M == N> a;
+        a = a;
+    }
+    return minpoly_kernel(core, M);
+}
+
+// x with A x = b, for a square nonsingular A
+template <unsigned M, unsigned N, typename Field>
+template <unsigned K>
+Matrix<N, K, Field> Matrix<M, N, Field>::solve(const Matrix<M, K, Field>& b) const {
+    if (M != N) {
+        compilation_error<M == N> a;
+        a = a;
+    }
+    Matrix<N, K, Field> result;
+    result.core = solve_kernel(core, b.core, M, K);
+    return result;
+}
+
+template <unsigned N>
+std::vector<complex> eigenvalues(const Matrix<N, N, double>& a) {
+    std::vector<std::vector<double>> table(N);
+    for (unsigned i = 0; i < N; ++i) {
+        table[i] = a[i];
+    }
+    return eigenvalues_kernel(table, N);
+}
+
+template <unsigned M, unsigned N, unsigned K, typename Field>
+Matrix<M, N, Field> strassen(const Matrix<M, K, Field>& a, const Matrix<K, N, Field>& b) {
+    Matrix<M, N, Field> result;
+    result.core = strassen_kernel(a.core, b.core, M, N, K);
+    return result;
+}
+template <unsigned M, unsigned N, unsigned K, typename Field>
+Matrix<M, N, Field> operator*(const Matrix<M, K, Field>& a, const Matrix<K, N, Field>& b) {
+    Matrix <M, N, Field> result;
+    result.core = multiply_kernel(a.core, b.core, M, N, K);
+    return result;
+}
+// A.transposedView() * B never materializes the transpose
+template <unsigned M, unsigned N, unsigned K, typename Field>
+Matrix<M, N, Field> operator*(const MatrixTransposed<Matrix<K, M, Field>>& a, const Matrix<K, N, Field>& b) {
+    Matrix<M, N, Field> result;
+    result.core = transposed_multiply_kernel(a.base().core, b.core, M, N, K);
+    return result;
+}
+
+// products are not element-wise, so expression operands are materialized first
+template <typename L, typename R>
+auto operator*(const MatrixExpression<L>& a, const MatrixExpression<R>& b) {
+    return a.eval() * b.eval();
+}
+template <unsigned M, unsigned N, typename Field>
+Matrix<M, N, Field>& Matrix<M, N, Field>::operator*=(Matrix<M, N, Field>& a) {
+    if (M != N) {
+        compilation_error<M == N> a;
+        a = a;
+    }
+    core = multiply_kernel(core, a.core, M, N, N);
+    return *this;
+}
+template <unsigned M, unsigned N, typename Field>
+Matrix<M, N, Field> Matrix<M, N, Field>::pow(unsigned long long k) const {
+    if (M != N) {
+        compilation_error<M == N> a;
+        a = a;
+    }
+    Matrix<M, N, Field> result;
+    result.core = power_kernel(core, M, k);
+    return result;
+}
+
+template <unsigned M, unsigned N, typename Field>
+Matrix<M, N, Field> Matrix<M, N, Field>::getGauss() const {
+    Matrix<M, N, Field> h(*this);
+    gauss_kernel(h.core, M, N);
+    return h;
+}
+template <unsigned M, unsigned N, typename Field>
+unsigned Matrix<M, N, Field>::rank() const {
+    return rank_kernel(core, M, N);
+}
+
+template <unsigned N, typename Field = Rational>
+class LU: public LUFactorization<Field> {
+public:
+    explicit LU(const Matrix<N, N, Field>& a);
+
+    using LUFactorization<Field>::solve;
+    template <unsigned K>
+    Matrix<N, K, Field> solve(const Matrix<N, K, Field>& b) const;
+    Matrix<N, N, Field> inverse() const;
+};
+
+template <unsigned N, typename Field>
+LU<N, Field>::LU(const Matrix<N, N, Field>& a): LUFactorization<Field>(a.core, N) {}
+
+template <unsigned N, typename Field>
+template <unsigned K>
+Matrix<N, K, Field> LU<N, Field>::solve(const Matrix<N, K, Field>& b) const {
+    Matrix<N, K, Field> result;
+    for (unsigned k = 0; k < K; ++k) {
+        std::vector<Field> x = solve(b.getColumn(k));
+        for (unsigned i = 0; i < N; ++i) {
+            result[i][k] = x[i];
+        }
+    }
+    return result;
+}
+
+template <unsigned N, typename Field>
+Matrix<N, N, Field> LU<N, Field>::inverse() const {
+    return Matrix<N, N, Field>(this->inverseTable());
+}
+
+template <unsigned M, unsigned N, typename Field>
+Field Matrix<M, N, Field>::det() const {
+    if (M != N) {
+        compilation_error<M == N> a;
+        a = a;
+    }
+    return det_kernel(core, M);
+}
+
+template <unsigned M, unsigned N, typename Field>
+void Matrix<M, N, Field>::invert() {
+    if (M != N) {
+        compilation_error<M == N> a;
+        a = a;
+    }
+    if (M <= 4) {
+        core = small_inverse_kernel(core, M);
+        return;
+    }
+    *this = LU<M, Field>(*this).inverse();
+}
+
+template <unsigned M, unsigned N, typename Field>
+Matrix<M, N, Field> Matrix<M, N, Field>::inverted() const {
+    Matrix<M, N, Field> result = *this;
+    result.invert();
+    return result;
+}
+
+// Runtime-sized counterpart of Matrix<M, N, Field>: same interface, same kernels.
+template <typename Field = Rational>
+class DynamicMatrix {
+private:
+    unsigned rows_ = 0;
+    unsigned cols_ = 0;
+    std::vector<std::vector<Field>> core;
+public:
+    DynamicMatrix(unsigned rows, unsigned cols): rows_(rows), cols_(cols), core(rows, std::vector<Field>(cols)) {}
+
+    DynamicMatrix(const std::initializer_list<std::initializer_list<int>>& I): rows_(I.size()) {
+        for (auto& i : I) {
+            cols_ = std::max(cols_, static_cast<unsigned>(i.size()));
+        }
+        core.assign(rows_, std::vector<Field>(cols_));
+        int it = 0;
+        for (auto& i : I) {
+            int it2 = 0;
+            for (auto& j : i) {
+                core[it][it2] = Field(j);
+                ++it2;
+            }
+            ++it;
+        }
+    }
+    DynamicMatrix(const std::vector<std::vector<int>>& I): rows_(I.size()), cols_(I.empty() ? 0 : I[0].size()) {
+        core.assign(rows_, std::vector<Field>(cols_));
+        for (unsigned i = 0; i < rows_; ++i) {
+            for (size_t j = 0; j < I[i].size(); ++j) {
+                core[i][j] = Field(I[i][j]);
+            }
+        }
+    }
+    DynamicMatrix(const std::vector<std::vector<Field>>& I):
+            rows_(I.size()), cols_(I.empty() ? 0 : I[0].size()), core(I) {}
+
+    template <unsigned M, unsigned N>
+    DynamicMatrix(const Matrix<M, N, Field>& a): rows_(M), cols_(N), core(a.core) {}
+
+    template <unsigned M, unsigned N>
+    Matrix<M, N, Field> toMatrix() const {
+        assert(rows_ == M && cols_ == N);
+        Matrix<M, N, Field> result;
+        result.core = core;
+        return result;
+    }
+
+    unsigned rows() const {
+        return rows_;
+    }
+    unsigned cols() const {
+        return cols_;
+    }
+
+    DynamicMatrix<Field>& operator+=(const DynamicMatrix<Field>&);
+    DynamicMatrix<Field> operator+(const DynamicMatrix<Field>&) const;
+    DynamicMatrix<Field>& operator-=(const DynamicMatrix<Field>&);
+    DynamicMatrix<Field> operator-(const DynamicMatrix<Field>&) const;
+    DynamicMatrix<Field>& operator*=(const Field&);
+    DynamicMatrix<Field> operator*(const Field&) const;
+
+    DynamicMatrix<Field> transposed() const;
+    void transpose();
+    DynamicMatrix<Field> getGauss() const;
+    unsigned rank() const;
+
+    std::vector<Field> getRow(unsigned) const;
+    std::vector<Field> getColumn(unsigned) const;
+
+    std::vector<Field>& operator[](unsigned);
+    const std::vector<Field>& operator[](unsigned) const;
+
+    DynamicMatrix<Field>& operator*=(const DynamicMatrix<Field>& a);
+    DynamicMatrix<Field> pow(unsigned long long k) const;
+    Field det() const;
+    DynamicMatrix<Field> inverted() const;
+    void invert();
+    Field trace() const;
+    polynom<Field> charpoly() const;
+    polynom<Field> minpoly() const;
+    DynamicMatrix<Field> solve(const DynamicMatrix<Field>& b) const;
+
+    template <typename Field1>
+    friend DynamicMatrix<Field1> operator*(const DynamicMatrix<Field1>&, const DynamicMatrix<Field1>&);
+};
+
+template <typename Field>
+DynamicMatrix<Field>& DynamicMatrix<Field>::operator+=(const DynamicMatrix<Field>& a) {
+    assert(rows_ == a.rows_ && cols_ == a.cols_);
+    for (unsigned i = 0; i < rows_; ++i) {
+        for (unsigned j = 0; j < cols_; ++j) {
+            core[i][j] += a.core[i][j];
+        }
+    }
+    return *this;
+}
+
+template <typename Field>
+DynamicMatrix<Field> DynamicMatrix<Field>::operator+(const DynamicMatrix<Field>& a) const {
+    DynamicMatrix<Field> res = *this;
+    return res += a;
+}
+
+template <typename Field>
+DynamicMatrix<Field>& DynamicMatrix<Field>::operator-=(const DynamicMatrix<Field>& a) {
+    assert(rows_ == a.rows_ && cols_ == a.cols_);
+    for (unsigned i = 0; i < rows_; ++i) {
+        for (unsigned j = 0; j < cols_; ++j) {
+            core[i][j] -= a.core[i][j];
+        }
+    }
+    return *this;
+}
+
+template <typename Field>
+DynamicMatrix<Field> DynamicMatrix<Field>::operator-(const DynamicMatrix<Field>& a) const {
+    DynamicMatrix<Field> res = *this;
+    return res -= a;
+}
+
+template <typename Field>
+DynamicMatrix<Field>& DynamicMatrix<Field>::operator*=(const Field& a) {
+    for (unsigned i = 0; i < rows_; ++i) {
+        for (unsigned j = 0; j < cols_; ++j) {
+            core[i][j] *= a;
+        }
+    }
+    return *this;
+}
+
+template <typename Field>
+DynamicMatrix<Field> DynamicMatrix<Field>::operator*(const Field& a) const {
+    DynamicMatrix<Field> res = *this;
+    return res *= a;
+}
+
+template <typename Field>
+DynamicMatrix<Field> operator*(const Field& a, const DynamicMatrix<Field>& b) {
+    return b * a;
+}
+
+template <typename Field>
+bool operator==(const DynamicMatrix<Field>& a, const DynamicMatrix<Field>& b) {
+    if (a.rows() != b.rows() || a.cols() != b.cols())
+        return false;
+    for (unsigned i = 0; i < a.rows(); ++i) {
+        if (a[i] != b[i])
+            return false;
+    }
+    return true;
+}
+
+template <typename Field>
+bool operator!=(const DynamicMatrix<Field>& a, const DynamicMatrix<Field>& b) {
+    return !(a == b);
+}
+
+template <typename Field>
+DynamicMatrix<Field> DynamicMatrix<Field>::transposed() const {
+    DynamicMatrix<Field> res(cols_, rows_);
+    transpose_kernel(core, res.core, rows_, cols_);
+    return res;
+}
+
+template <typename Field>
+void DynamicMatrix<Field>::transpose() {
+    if (rows_ == cols_)
+        transpose_in_place_kernel(core, 0, rows_);
+    else
+        *this = transposed();
+}
+
+template <typename Field>
+std::vector<Field> DynamicMatrix<Field>::getRow(unsigned i) const {
+    return core[i];
+}
+
+template <typename Field>
+std::vector<Field> DynamicMatrix<Field>::getColumn(unsigned i) const {
+    std::vector<Field> res(rows_);
+    for (unsigned j = 0; j < rows_; ++j) {
+        res[j] = core[j][i];
+    }
+    return res;
+}
+
+template <typename Field>
+std::vector<Field>& DynamicMatrix<Field>::operator[](unsigned i) {
+    return core[i];
+}
+
+template <typename Field>
+const std::vector<Field>& DynamicMatrix<Field>::operator[](unsigned i) const {
+    return core[i];
+}
+
+template <typename Field>
+Field DynamicMatrix<Field>::trace() const {
+    assert(rows_ == cols_);
+    Field res(0);
+    for (unsigned i = 0; i < rows_; ++i) {
+        res += core[i][i];
+    }
+    return res;
+}
+
+template <typename Field>
+polynom<Field> DynamicMatrix<Field>::charpoly() const {
+    assert(rows_ == cols_);
+    return charpoly_kernel(core, rows_);
+}
+
+template <typename Field>
+polynom<Field> DynamicMatrix<Field>::minpoly() const {
+    assert(rows_ == cols_);
+    return minpoly_kernel(core, rows_);
+}
+
+template <typename Field>
+DynamicMatrix<Field> DynamicMatrix<Field>::solve(const DynamicMatrix<Field>& b) const {
+    assert(rows_ == cols_ && b.rows_ == rows_);
+    return DynamicMatrix<Field>(solve_kernel(core, b.core, rows_, b.cols_));
+}
+
+std::vector<complex> eigenvalues(const DynamicMatrix<double>& a) {
+    assert(a.rows() == a.cols());
+    std::vector<std::vector<double>> table(a.rows());
+    for (unsigned i = 0; i < a.rows(); ++i) {
+        table[i] = a[i];
+    }
+    return eigenvalues_kernel(table, a.rows());
+}
+
+template <typename Field>
+DynamicMatrix<Field> operator*(const DynamicMatrix<Field>& a, const DynamicMatrix<Field>& b) {
+    assert(a.cols_ == b.rows_);
+    return DynamicMatrix<Field>(multiply_kernel(a.core, b.core, a.rows_, b.cols_, a.cols_));
+}
+
+template <typename Field>
+DynamicMatrix<Field>& DynamicMatrix<Field>::operator*=(const DynamicMatrix<Field>& a) {
+    assert(cols_ == a.rows_);
+    core = multiply_kernel(core, a.core, rows_, a.cols_, cols_);
+    cols_ = a.cols_;
+    return *this;
+}
+
+template <typename Field>
+DynamicMatrix<Field> DynamicMatrix<Field>::pow(unsigned long long k) const {
+    assert(rows_ == cols_);
+    return DynamicMatrix<Field>(power_kernel(core, rows_, k));
+}
+
+template <typename Field>
+DynamicMatrix<Field> DynamicMatrix<Field>::getGauss() const {
+    DynamicMatrix<Field> h = *this;
+    gauss_kernel(h.core, rows_, cols_);
+    return h;
+}
+
+template <typename Field>
+unsigned DynamicMatrix<Field>::rank() const {
+    return rank_kernel(core, rows_, cols_);
+}
+
+template <typename Field>
+Field DynamicMatrix<Field>::det() const {
+    assert(rows_ == cols_);
+    return det_kernel(core, rows_);
+}
+
+template <typename Field>
+void DynamicMatrix<Field>::invert() {
+    assert(rows_ == cols_);
+    if (rows_ > 0 && rows_ <= 4)
+        core = small_inverse_kernel(core, rows_);
+    else
+        core = LUFactorization<Field>(core, rows_).inverseTable();
+}
+
+template <typename Field>
+DynamicMatrix<Field> DynamicMatrix<Field>::inverted() const {
+    DynamicMatrix<Field> result = *this;
+    result.invert();
+    return result;
+}
+
+// Compressed sparse row storage: row i owns values[row_start[i] .. row_start[i + 1]) with
+// strictly increasing column indices. The CSC form of A is the CSR form of A.transposed().
+template <typename Field = Rational>
+class SparseMatrix {
+private:
+    unsigned rows_ = 0;
+    unsigned cols_ = 0;
+    std::vector<unsigned> row_start;
+    std::vector<unsigned> column;
+    std::vector<Field> values;
+public:
+    SparseMatrix(unsigned rows, unsigned cols): rows_(rows), cols_(cols), row_start(rows + 1, 0) {}
+    // duplicates are summed, zero entries are dropped
+    SparseMatrix(unsigned rows, unsigned cols, std::vector<std::tuple<unsigned, unsigned, Field>> entries);
+    explicit SparseMatrix(const DynamicMatrix<Field>& a);
+    template <unsigned M, unsigned N>
+    explicit SparseMatrix(const Matrix<M, N, Field>& a): SparseMatrix(DynamicMatrix<Field>(a)) {}
+
+    unsigned rows() const {
+        return rows_;
+    }
+    unsigned cols() const {
+        return cols_;
+    }
+    unsigned nonZeros() const {
+        return values.size();
+    }
+    unsigned rowBegin(unsigned i) const {
+        return row_start[i];
+    }
+    unsigned rowEnd(unsigned i) const {
+        return row_start[i + 1];
+    }
+    unsigned columnAt(unsigned k) const {
+        return column[k];
+    }
+    const Field& valueAt(unsigned k) const {
+        return values[k];
+    }
+
+    Field get(unsigned i, unsigned j) const;
+    SparseMatrix<Field> transposed() const;
+    DynamicMatrix<Field> toDense() const;
+
+    std::vector<Field> operator*(const std::vector<Field>& x) const;
+
+    unsigned rank() const;
+    Field det() const;
+    std::vector<Field> solve(const std::vector<Field>& b) const;
+};
+
+template <typename Field>
+SparseMatrix<Field>::SparseMatrix(unsigned rows, unsigned cols, std::vector<std::tuple<unsigned, unsigned, Field>> entries):
+        rows_(rows), cols_(cols), row_start(rows + 1, 0) {
+    std::sort(entries.begin(), entries.end(), [](const auto& a, const auto& b) {
+        return std::get<0>(a) != std::get<0>(b) ? std::get<0>(a) < std::get<0>(b) : std::get<1>(a) < std::get<1>(b);
+    });
+    for (size_t k = 0; k < entries.size();) {
+        unsigned i = std::get<0>(entries[k]);
+        unsigned j = std::get<1>(entries[k]);
+        assert(i < rows_ && j < cols_);
+        Field x = std::get<2>(entries[k]);
+        for (++k; k < entries.size() && std::get<0>(entries[k]) == i && std::get<1>(entries[k]) == j; ++k) {
+            x += std::get<2>(entries[k]);
+        }
+        if (compare_to_zero(x))
+            continue;
+        ++row_start[i + 1];
+        column.push_back(j);
+        values.push_back(x);
+    }
+    for (unsigned i = 0; i < rows_; ++i) {
+        row_start[i + 1] += row_start[i];
+    }
+}
+
+template <typename Field>
+SparseMatrix<Field>::SparseMatrix(const DynamicMatrix<Field>& a): rows_(a.rows()), cols_(a.cols()), row_start(a.rows() + 1, 0) {
+    for (unsigned i = 0; i < rows_; ++i) {
+        for (unsigned j = 0; j < cols_; ++j) {
+            if (!compare_to_zero(a[i][j])) {
+                column.push_back(j);
+                values.push_back(a[i][j]);
+            }
+        }
+        row_start[i + 1] = values.size();
+    }
+}
+
+template <typename Field>
+Field SparseMatrix<Field>::get(unsigned i, unsigned j) const {
+    auto first = column.begin() + row_start[i];
+    auto last = column.begin() + row_start[i + 1];
+    auto it = std::lower_bound(first, last, j);
+    if (it == last || *it != j)
+        return Field(0);
+    return values[it - column.begin()];
+}
+
+// counting sort by column: O(nnz + rows + cols), keeps columns sorted inside each row
+template <typename Field>
+SparseMatrix<Field> SparseMatrix<Field>::transposed() const {
+    SparseMatrix<Field> res(cols_, rows_);
+    res.column.resize(values.size());
+    res.values.resize(values.size());
+    for (unsigned k = 0; k < values.size(); ++k) {
+        ++res.row_start[column[k] + 1];
+    }
+    for (unsigned j = 0; j < cols_; ++j) {
+        res.row_start[j + 1] += res.row_start[j];
+    }
+    std::vector<unsigned> next(res.row_start.begin(), res.row_start.end() - 1);
+    for (unsigned i = 0; i < rows_; ++i) {
+        for (unsigned k = row_start[i]; k < row_start[i + 1]; ++k) {
+            unsigned place = next[column[k]]++;
+            res.column[place] = i;
+            res.values[place] = values[k];
+        }
+    }
+    return res;
+}
+
+template <typename Field>
+DynamicMatrix<Field> SparseMatrix<Field>::toDense() const {
+    DynamicMatrix<Field> res(rows_, cols_);
+    for (unsigned i = 0; i < rows_; ++i) {
+        for (unsigned k = row_start[i]; k < row_start[i + 1]; ++k) {
+            res[i][column[k]] = values[k];
+        }
+    }
+    return res;
+}
+
+template <typename Field>
+std::vector<Field> SparseMatrix<Field>::operator*(const std::vector<Field>& x) const {
+    assert(x.size() == cols_);
+    std::vector<Field> res(rows_, Field(0));
+    for (unsigned i = 0; i < rows_; ++i) {
+        for (unsigned k = row_start[i]; k < row_start[i + 1]; ++k) {
+            res[i] += values[k] * x[column[k]];
+        }
+    }
+    return res;
+}
+
+template <typename Field>
+DynamicMatrix<Field> operator*(const SparseMatrix<Field>& a, const DynamicMatrix<Field>& b) {
+    assert(a.cols() == b.rows());
+    DynamicMatrix<Field> res(a.rows(), b.cols());
+    for (unsigned i = 0; i < a.rows(); ++i) {
+        std::vector<Field>& row = res[i];
+        for (unsigned k = a.rowBegin(i); k < a.rowEnd(i); ++k) {
+            const Field& x = a.valueAt(k);
+            const std::vector<Field>& b_row = b[a.columnAt(k)];
+            for (unsigned j = 0; j < b.cols(); ++j) {
+                row[j] += x * b_row[j];
+            }
+        }
+    }
+    return res;
+}
+
+template <unsigned K, unsigned N, typename Field>
+DynamicMatrix<Field> operator*(const SparseMatrix<Field>& a, const Matrix<K, N, Field>& b) {
+    return a * DynamicMatrix<Field>(b);
+}
+
+// Gustavson's row-by-row product with a dense accumulator, O(flops + nnz) per call
+template <typename Field>
+SparseMatrix<Field> operator*(const SparseMatrix<Field>& a, const SparseMatrix<Field>& b) {
+    assert(a.cols() == b.rows());
+    std::vector<std::tuple<unsigned, unsigned, Field>> entries;
+    std::vector<Field> accumulator(b.cols());
+    std::vector<unsigned> last_row(b.cols(), a.rows());
+    std::vector<unsigned> touched;
+    for (unsigned i = 0; i < a.rows(); ++i) {
+        touched.clear();
+        for (unsigned k = a.rowBegin(i); k < a.rowEnd(i); ++k) {
+            unsigned t = a.columnAt(k);
+            for (unsigned l = b.rowBegin(t); l < b.rowEnd(t); ++l) {
+                unsigned j = b.columnAt(l);
+                if (last_row[j] != i) {
+                    last_row[j] = i;
+                    accumulator[j] = Field(0);
+                    touched.push_back(j);
+                }
+                accumulator[j] += a.valueAt(k) * b.valueAt(l);
+            }
+        }
+        for (unsigned j : touched) {
+            entries.emplace_back(i, j, accumulator[j]);
+        }
+    }
+    return SparseMatrix<Field>(a.rows(), b.cols(), std::move(entries));
+}
+
+// Exact sparse LU. Every step takes the pivot with the smallest Markowitz cost
+// (row count - 1) * (column count - 1) among the entries of the sparsest active row and
+// the sparsest active column, which keeps fill-in low. Active rows and columns are kept
+// ordered by their counts and re-keyed on every fill-in and cancellation, so finding the
+// sparsest ones costs O(log n) instead of a scan. The row operations are recorded, so
+// solve() can be repeated for any right-hand side.
+template <typename Field>
+class SparseLU {
+private:
+    unsigned n_rows;
+    unsigned n_cols;
+    std::vector<std::map<unsigned, Field>> rows;
+    std::vector<unsigned> pivot_row;
+    std::vector<unsigned> pivot_col;
+    std::vector<std::tuple<unsigned, unsigned, Field>> operations;
+public:
+    explicit SparseLU(const SparseMatrix<Field>& a);
+
+    unsigned rank() const {
+        return pivot_row.size();
+    }
+    Field det() const;
+    std::vector<Field> solve(std::vector<Field> b) const;
+};
+
+template <typename Field>
+SparseLU<Field>::SparseLU(const SparseMatrix<Field>& a): n_rows(a.rows()), n_cols(a.cols()), rows(a.rows()) {
+    std::vector<std::set<unsigned>> col_rows(n_cols);
+    for (unsigned i = 0; i < n_rows; ++i) {
+        for (unsigned k = a.rowBegin(i); k < a.rowEnd(i); ++k) {
+            rows[i].emplace_hint(rows[i].end(), a.columnAt(k), a.valueAt(k));
+            col_rows[a.columnAt(k)].insert(i);
+        }
+    }
+    // (count, index) of the rows and columns that still hold an entry
+    std::set<std::pair<size_t, unsigned>> row_order;
+    std::set<std::pair<size_t, unsigned>> col_order;
+    for (unsigned i = 0; i < n_rows; ++i) {
+        if (!rows[i].empty())
+            row_order.emplace(rows[i].size(), i);
+    }
+    for (unsigned j = 0; j < n_cols; ++j) {
+        if (!col_rows[j].empty())
+            col_order.emplace(col_rows[j].size(), j);
+    }
+    auto unlist_row = [&](unsigned i) { row_order.erase({rows[i].size(), i}); };
+    auto list_row = [&](unsigned i) {
+        if (!rows[i].empty())
+            row_order.emplace(rows[i].size(), i);
+    };
+    auto unlist_col = [&](unsigned j) { col_order.erase({col_rows[j].size(), j}); };
+    auto list_col = [&](unsigned j) {
+        if (!col_rows[j].empty())
+            col_order.emplace(col_rows[j].size(), j);
+    };
+    while (!row_order.empty()) {
+        unsigned best_row = row_order.begin()->second;
+        unsigned best_col = col_order.begin()->second;
+        unsigned r = best_row;
+        unsigned c = rows[best_row].begin()->first;
+        size_t cost = -1;
+        for (const auto& entry : rows[best_row]) {
+            size_t current = (rows[best_row].size() - 1) * (col_rows[entry.first].size() - 1);
+            if (current < cost) {
+                cost = current;
+                c = entry.first;
+            }
+        }
+        for (unsigned i : col_rows[best_col]) {
+            size_t current = (rows[i].size() - 1) * (col_rows[best_col].size() - 1);
+            if (current < cost) {
+                cost = current;
+                r = i;
+                c = best_col;
+            }
+        }
+
+        unlist_row(r);
+        pivot_row.push_back(r);
+        pivot_col.push_back(c);
+        for (const auto& entry : rows[r]) {
+            unlist_col(entry.first);
+            col_rows[entry.first].erase(r);
+            list_col(entry.first);
+        }
+        Field pivot = rows[r][c];
+        std::vector<unsigned> targets(col_rows[c].begin(), col_rows[c].end());
+        for (unsigned i : targets) {
+            Field factor = rows[i][c] / pivot;
+            operations.emplace_back(i, r, factor);
+            unlist_row(i);
+            for (const auto& entry : rows[r]) {
+                auto it = rows[i].find(entry.first);
+                if (it == rows[i].end()) {
+                    unlist_col(entry.first);
+                    rows[i].emplace(entry.first, -(entry.second * factor));
+                    col_rows[entry.first].insert(i);
+                    list_col(entry.first);
+                    continue;
+                }
+                it->second -= entry.second * factor;
+                if (entry.first == c || compare_to_zero(it->second)) {
+                    unlist_col(entry.first);
+                    col_rows[entry.first].erase(i);
+                    rows[i].erase(it);
+                    list_col(entry.first);
+                }
+            }
+            list_row(i);
+        }
+    }
+}
+
+template <typename Field>
+Field SparseLU<Field>::det() const {
+    assert(n_rows == n_cols);
+    if (rank() < n_rows)
+        return Field(0);
+    std::vector<unsigned> col_of_row(n_rows);
+    Field res(1);
+    for (unsigned k = 0; k < rank(); ++k) {
+        col_of_row[pivot_row[k]] = pivot_col[k];
+        res *= rows[pivot_row[k]].at(pivot_col[k]);
+    }
+    bool odd = false;
+    std::vector<bool> visited(n_rows, false);
+    for (unsigned i = 0; i < n_rows; ++i) {
+        unsigned length = 0;
+        for (unsigned j = i; !visited[j]; j = col_of_row[j]) {
+            visited[j] = true;
+            ++length;
+        }
+        if (length > 0 && length % 2 == 0)
+            odd ^= 1;
+    }
+    return odd ? -res : res;
+}
+
+template <typename Field>
+std::vector<Field> SparseLU<Field>::solve(std::vector<Field> b) const {
+    assert(n_rows == n_cols && rank() == n_rows && b.size() == n_rows);
+    for (const auto& operation : operations) {
+        b[std::get<0>(operation)] -= std::get<2>(operation) * b[std::get<1>(operation)];
+    }
+    std::vector<Field> x(n_cols, Field(0));
+    for (unsigned k = rank(); k-- > 0;) {
+        unsigned r = pivot_row[k];
+        unsigned c = pivot_col[k];
+        Field value = b[r];
+        for (const auto& entry : rows[r]) {
+            if (entry.first != c)
+                value -= entry.second * x[entry.first];
+        }
+        value /= rows[r].at(c);
+        x[c] = value;
+    }
+    return x;
+}
+
+template <typename Field>
+unsigned SparseMatrix<Field>::rank() const {
+    return SparseLU<Field>(*this).rank();
+}
+
+template <typename Field>
+Field SparseMatrix<Field>::det() const {
+    return SparseLU<Field>(*this).det();
+}
+
+template <typename Field>
+std::vector<Field> SparseMatrix<Field>::solve(const std::vector<Field>& b) const {
+    return SparseLU<Field>(*this).solve(b);
+}
+
+// Structure-of-arrays batch of W small N x N matrices: element (i, j) of all W matrices is
+// stored contiguously, so every operation is a loop over lanes that compiles to SIMD code.
+template <unsigned N, typename T = double, unsigned W = 8>
+struct MatrixBatch {
+    T data[N][N][W];
+
+    void load(unsigned lane, const Matrix<N, N, T>& a) {
+        for (unsigned i = 0; i < N; ++i) {
+            for (unsigned j = 0; j < N; ++j) {
+                data[i][j][lane] = a.at(i, j);
+            }
+        }
+    }
+
+    Matrix<N, N, T> extract(unsigned lane) const {
+        Matrix<N, N, T> result;
+        for (unsigned i = 0; i < N; ++i) {
+            for (unsigned j = 0; j < N; ++j) {
+                result[i][j] = data[i][j][lane];
+            }
+        }
+        return result;
+    }
+
+    std::array<T, W> det() const {
+        std::array<T, W> result;
+        for (unsigned w = 0; w < W; ++w) {
+            result[w] = small_det<T>([this, w](unsigned i, unsigned j) { return data[i][j][w]; }, N);
+        }
+        return result;
+    }
+
+    MatrixBatch<N, T, W> inverted() const {
+        MatrixBatch<N, T, W> result;
+        for (unsigned w = 0; w < W; ++w) {
+            small_inverse<T>([this, w](unsigned i, unsigned j) { return data[i][j][w]; },
+                             [&result, w](unsigned i, unsigned j, T x) { result.data[i][j][w] = x; }, N);
+        }
+        return result;
+    }
+};
+
+template <unsigned N, typename T, unsigned W>
+MatrixBatch<N, T, W> operator*(const MatrixBatch<N, T, W>& a, const MatrixBatch<N, T, W>& b) {
+    MatrixBatch<N, T, W> c;
+    for (unsigned i = 0; i < N; ++i) {
+        for (unsigned j = 0; j < N; ++j) {
+            for (unsigned w = 0; w < W; ++w) {
+                c.data[i][j][w] = a.data[i][0][w] * b.data[0][j][w];
+            }
+            for (unsigned k = 1; k < N; ++k) {
+                for (unsigned w = 0; w < W; ++w) {
+                    c.data[i][j][w] += a.data[i][k][w] * b.data[k][j][w];
+                }
+            }
+        }
+    }
+    return c;
+}
+
+// Directed rounding through error-free transformations: the exact error of every operation
+// is recovered (TwoSum, fma), and the result moves one ulp only if it was rounded the wrong
+// way. Exact results, zeros in particular, stay exact.
+double round_down(double value, double error) {
+    return error < 0 ? std::nextafter(value, -INFINITY) : value;
+}
+
+double round_up(double value, double error) {
+    return error > 0 ? std::nextafter(value, INFINITY) : value;
+}
+
+double sum_error(double a, double b, double s) {
+    double bb = s - a;
+    return (a - (s - bb)) + (b - bb);
+}
+
+// Closed interval of doubles that is guaranteed to contain the exact value.
+struct Interval {
+    double lo = 0;
+    double hi = 0;
+
+    Interval() {}
+    Interval(double x): lo(x), hi(x) {}
+    Interval(int x): lo(x), hi(x) {}
+    Interval(double l, double h): lo(l), hi(h) {}
+
+    bool isZero() const {
+        return lo == 0 && hi == 0;
+    }
+    bool containsZero() const {
+        return lo <= 0 && hi >= 0;
+    }
+    // smallest absolute value in the interval
+    double mignitude() const {
+        return containsZero() ? 0 : std::min(std::abs(lo), std::abs(hi));
+    }
+    // largest absolute value in the interval
+    double magnitude() const {
+        return std::max(std::abs(lo), std::abs(hi));
+    }
+
+    Interval& operator+=(const Interval& a) {
+        double l = lo + a.lo;
+        double h = hi + a.hi;
+        lo = round_down(l, sum_error(lo, a.lo, l));
+        hi = round_up(h, sum_error(hi, a.hi, h));
+        return *this;
+    }
+    Interval& operator-=(const Interval& a) {
+        return *this += Interval(-a.hi, -a.lo);
+    }
+    Interval& operator*=(const Interval& a) {
+        double l = INFINITY;
+        double h = -INFINITY;
+        for (double x : {lo, hi}) {
+            for (double y : {a.lo, a.hi}) {
+                double p = x * y;
+                double error = std::fma(x, y, -p);
+                l = std::min(l, round_down(p, error));
+                h = std::max(h, round_up(p, error));
+            }
+        }
+        lo = l;
+        hi = h;
+        return *this;
+    }
+    Interval& operator/=(const Interval& a) {
+        if (a.containsZero()) {
+            lo = -INFINITY;
+            hi = INFINITY;
+            return *this;
+        }
+        double l = INFINITY;
+        double h = -INFINITY;
+        for (double x : {lo, hi}) {
+            for (double y : {a.lo, a.hi}) {
+                double q = x / y;
+                // x - q * y is exact, and the true quotient is q + remainder / y
+                double remainder = std::fma(-q, y, x);
+                double error = y > 0 ? remainder : -remainder;
+                l = std::min(l, round_down(q, error));
+                h = std::max(h, round_up(q, error));
+            }
+        }
+        lo = l;
+        hi = h;
+        return *this;
+    }
+    Interval operator-() const {
+        return Interval(-hi, -lo);
+    }
+};
+
+Interval operator+(const Interval& a, const Interval& b) {
+    Interval x = a;
+    return x += b;
+}
+
+Interval operator-(const Interval& a, const Interval& b) {
+    Interval x = a;
+    return x -= b;
+}
+
+Interval operator*(const Interval& a, const Interval& b) {
+    Interval x = a;
+    return x *= b;
+}
+
+Interval operator/(const Interval& a, const Interval& b) {
+    Interval x = a;
+    return x /= b;
+}
+
+bool operator==(const Interval& a, const Interval& b) {
+    return a.lo == b.lo && a.hi == b.hi;
+}
+
+bool operator!=(const Interval& a, const Interval& b) {
+    return !(a == b);
+}
+
+template <>
+bool compare_to_zero<Interval>(const Interval& a) {
+    return a.isZero();
+}
+
+template <>
+bool is_better_pivot<Interval>(const Interval& candidate, const Interval& current) {
+    return candidate.mignitude() > current.mignitude();
+}
+
+// Scales a row of finite doubles by a power of two so that every entry becomes an exact
+// integer. Positive row scaling changes neither the rank nor the sign of det.
+std::vector<BigInteger> dyadic_integer_row(const std::vector<double>& row) {
+    std::vector<long long> mantissas(row.size());
+    std::vector<int> exponents(row.size());
+    int lowest = std::numeric_limits<int>::max();
+    for (size_t j = 0; j < row.size(); ++j) {
+        mantissas[j] = static_cast<long long>(std::ldexp(std::frexp(row[j], &exponents[j]), 53));
+        exponents[j] -= 53;
+        if (mantissas[j] != 0)
+            lowest = std::min(lowest, exponents[j]);
+    }
+    std::vector<BigInteger> result(row.size());
+    for (size_t j = 0; j < row.size(); ++j) {
+        result[j] = BigInteger(mantissas[j]);
+        if (mantissas[j] == 0)
+            continue;
+        for (int k = exponents[j] - lowest; k > 0; k -= 30) {
+            result[j] *= BigInteger(1LL << std::min(k, 30));
+        }
+    }
+    return result;
+}
+
+// Floating point elimination with partial pivoting on a. Returns the pivot column of every
+// pivot row; y receives the row transform (a row permutation of a unit lower triangular
+// matrix, so det y is exactly parity) and h receives y * a as computed in doubles.
+std::vector<unsigned> float_elimination(const std::vector<std::vector<double>>& a, unsigned rows, unsigned cols,
+                                        std::vector<std::vector<double>>& y, std::vector<std::vector<double>>& h,
+                                        int& parity) {
+    h = a;
+    y.assign(rows, std::vector<double>(rows, 0));
+    for (unsigned i = 0; i < rows; ++i) {
+        y[i][i] = 1;
+    }
+    parity = 1;
+    std::vector<unsigned> pivots;
+    for (unsigned J = 0; J < cols && pivots.size() < rows; ++J) {
+        unsigned place = pivots.size();
+        unsigned pos = place;
+        for (unsigned i = place + 1; i < rows; ++i) {
+            if (is_better_pivot(h[i][J], h[pos][J]))
+                pos = i;
+        }
+        // exact test: a tiny pivot is left to the certification instead of a scale-dependent eps
+        if (h[pos][J] == 0)
+            continue;
+        if (pos != place) {
+            std::swap(h[pos], h[place]);
+            std::swap(y[pos], y[place]);
+            parity = -parity;
+        }
+        for (unsigned i = place + 1; i < rows; ++i) {
+            double con = h[i][J] / h[place][J];
+            if (con == 0)
+                continue;
+            for (unsigned j = J + 1; j < cols; ++j) {
+                h[i][j] -= h[place][j] * con;
+            }
+            for (unsigned j = 0; j < rows; ++j) {
+                y[i][j] -= y[place][j] * con;
+            }
+            h[i][J] = 0;
+        }
+        pivots.push_back(J);
+    }
+    return pivots;
+}
+
+// gamma_n = n u / (1 - n u) from the standard error analysis of floating point dot products:
+// |fl(x * y) - x * y| <= gamma_n |x| * |y| for vectors of length n
+double rounding_gamma(unsigned n) {
+    double u = std::numeric_limits<double>::epsilon() / 2;
+    return n * u / (1 - n * u);
+}
+
+// Certifies that the square block of a formed by the pivot columns and the first
+// pivots.size() rows of y * a is nonsingular; returns the sign of its det or 0 if the
+// bound cannot decide. With U the block of h, Z is a unit upper triangular approximate
+// inverse of diag(U)^-1 * U, so det Z = 1 and K = y * a * Z is nearly diagonal. K is
+// computed in doubles together with a rigorous bound on its rounding error and tested
+// for strict diagonal dominance, which implies that K is nonsingular with det sign equal
+// to the product of its diagonal signs. Interval elimination would be simpler but its
+// intervals grow exponentially with the size (wrapping effect).
+int certified_pivot_sign(const std::vector<std::vector<double>>& a, const std::vector<std::vector<double>>& y,
+                         const std::vector<std::vector<double>>& h, const std::vector<unsigned>& pivots) {
+    unsigned r = pivots.size();
+    unsigned rows = a.size();
+    std::vector<std::vector<double>> z(r, std::vector<double>(r, 0));
+    for (unsigned k = 0; k < r; ++k) {
+        z[k][k] = 1;
+        for (unsigned i = k; i-- > 0;) {
+            double sum = 0;
+            for (unsigned l = i + 1; l <= k; ++l) {
+                sum += h[i][pivots[l]] * z[l][k];
+            }
+            z[i][k] = -sum / h[i][pivots[i]];
+        }
+    }
+    // two extra units absorb the rounding of the bounds themselves
+    double gamma_g = rounding_gamma(rows + 2);
+    double gamma_k = rounding_gamma(r + 2);
+    double underflow = (rows + r) * std::numeric_limits<double>::denorm_min();
+    int sign = 1;
+    std::vector<double> g(r), g_abs(r), k(r), k_abs(r), e_abs(r);
+    for (unsigned i = 0; i < r; ++i) {
+        std::fill(g.begin(), g.end(), 0);
+        std::fill(g_abs.begin(), g_abs.end(), 0);
+        for (unsigned l = 0; l < rows; ++l) {
+            double con = y[i][l];
+            if (con == 0)
+                continue;
+            for (unsigned j = 0; j < r; ++j) {
+                double x = con * a[l][pivots[j]];
+                g[j] += x;
+                g_abs[j] += std::abs(x);
+            }
+        }
+        std::fill(k.begin(), k.end(), 0);
+        std::fill(k_abs.begin(), k_abs.end(), 0);
+        std::fill(e_abs.begin(), e_abs.end(), 0);
+        for (unsigned l = 0; l < r; ++l) {
+            for (unsigned j = l; j < r; ++j) {
+                double x = g[l] * z[l][j];
+                k[j] += x;
+                k_abs[j] += std::abs(x);
+                e_abs[j] += g_abs[l] * std::abs(z[l][j]);
+            }
+        }
+        // |K - fl(G) Z| <= gamma_g |y| |a| |Z| and |fl(G) Z - k| <= gamma_k |fl(G)| |Z|
+        double diagonal_error = 0;
+        double off_diagonal = 0;
+        for (unsigned j = 0; j < r; ++j) {
+            double error = gamma_k * k_abs[j] + gamma_g * (1 + gamma_k) * e_abs[j] + underflow;
+            if (j == i)
+                diagonal_error = error;
+            else
+                off_diagonal += std::abs(k[j]) + error;
+        }
+        if (!((std::abs(k[i]) - diagonal_error) * (1 - gamma_k) > off_diagonal * (1 + gamma_k)))
+            return 0;
+        if (k[i] < 0)
+            sign = -sign;
+    }
+    return sign;
+}
+
+std::vector<std::vector<BigInteger>> dyadic_integer_table(const std::vector<std::vector<double>>& a) {
+    std::vector<std::vector<BigInteger>> exact(a.size());
+    for (size_t i = 0; i < a.size(); ++i) {
+        exact[i] = dyadic_integer_row(a[i]);
+    }
+    return exact;
+}
+
+// Exact rank of a double matrix. A certified pivot block proves rank >= its size, which
+// settles full rank matrices in doubles; a floating point rank deficiency can never be
+// certified, so those (and ill-conditioned inputs) are recomputed exactly over the integers.
+unsigned adaptive_rank_kernel(const std::vector<std::vector<double>>& a, unsigned rows, unsigned cols) {
+    std::vector<std::vector<double>> y;
+    std::vector<std::vector<double>> h;
+    int parity = 1;
+    std::vector<unsigned> pivots = float_elimination(a, rows, cols, y, h, parity);
+    if (pivots.size() == std::min(rows, cols) && certified_pivot_sign(a, y, h, pivots) != 0)
+        return pivots.size();
+    std::vector<std::vector<BigInteger>> exact = dyadic_integer_table(a);
+    int sign = 1;
+    return bareiss_kernel(exact, rows, cols, sign);
+}
+
+// exact sign of det: -1, 0 or 1
+int adaptive_det_sign_kernel(const std::vector<std::vector<double>>& a, unsigned n) {
+    std::vector<std::vector<double>> y;
+    std::vector<std::vector<double>> h;
+    int parity = 1;
+    std::vector<unsigned> pivots = float_elimination(a, n, n, y, h, parity);
+    if (pivots.size() == n) {
+        int sign = certified_pivot_sign(a, y, h, pivots);
+        if (sign != 0)
+            return sign * parity;
+    }
+    std::vector<std::vector<BigInteger>> exact = dyadic_integer_table(a);
+    int sign = 1;
+    return bareiss_kernel(exact, n, n, sign) < n ? 0 : sign;
+}
+
+template <unsigned M, unsigned N>
+unsigned adaptive_rank(const Matrix<M, N, double>& a) {
+    std::vector<std::vector<double>> table(M);
+    for (unsigned i = 0; i < M; ++i) {
+        table[i] = a[i];
+    }
+    return adaptive_rank_kernel(table, M, N);
+}
+
+template <unsigned N>
+int adaptive_det_sign(const Matrix<N, N, double>& a) {
+    std::vector<std::vector<double>> table(N);
+    for (unsigned i = 0; i < N; ++i) {
+        table[i] = a[i];
+    }
+    return adaptive_det_sign_kernel(table, N);
+}
+
+unsigned adaptive_rank(const DynamicMatrix<double>& a) {
+    std::vector<std::vector<double>> table(a.rows());
+    for (unsigned i = 0; i < a.rows(); ++i) {
+        table[i] = a[i];
+    }
+    return adaptive_rank_kernel(table, a.rows(), a.cols());
+}
+
+int adaptive_det_sign(const DynamicMatrix<double>& a) {
+    assert(a.rows() == a.cols());
+    std::vector<std::vector<double>> table(a.rows());
+    for (unsigned i = 0; i < a.rows(); ++i) {
+        table[i] = a[i];
+    }
+    return adaptive_det_sign_kernel(table, a.rows());
+}
+
+// On-disk matrix: a 64-byte header, then the rows one after another. Trivially copyable
+// fields are stored as their raw bytes, so the payload can be mapped and read in place;
+// BigInteger and Rational are stored limb by limb and can only be streamed.
+// Multi-byte values use the byte order of the machine, checked through byte_order.
+struct MatrixFileHeader {
+    char magic[8] = {'M', 'A', 'T', 'R', 'I', 'X', '0', '1'};
+    uint32_t byte_order = 0x01020304;
+    uint32_t field = 0;
+    uint64_t rows = 0;
+    uint64_t cols = 0;
+    // 0 for variable-size fields
+    uint64_t element_size = 0;
+    // modulus of Residue<N>, 0 for other fields
+    uint64_t modulus = 0;
+    // side of the square tiles of a TiledMatrix file, 0 for row-major files
+    uint64_t tile = 0;
+    char reserved[8] = {};
+};
+
+template <typename Field>
+struct field_tag;
+
+template <>
+struct field_tag<double> {
+    static const uint32_t value = 1;
+    static const uint64_t modulus = 0;
+};
+
+template <>
+struct field_tag<float> {
+    static const uint32_t value = 2;
+    static const uint64_t modulus = 0;
+};
+
+template <>
+struct field_tag<int> {
+    static const uint32_t value = 3;
+    static const uint64_t modulus = 0;
+};
+
+template <>
+struct field_tag<long long> {
+    static const uint32_t value = 4;
+    static const uint64_t modulus = 0;
+};
+
+template <unsigned N>
+struct field_tag<Residue<N>> {
+    static const uint32_t value = 5;
+    static const uint64_t modulus = N;
+};
+
+template <uint64_t N>
+struct field_tag<Residue64<N>> {
+    static const uint32_t value = 9;
+    static const uint64_t modulus = N;
+};
+
+template <>
+struct field_tag<Rational> {
+    static const uint32_t value = 6;
+    static const uint64_t modulus = 0;
+};
+
+template <>
+struct field_tag<BigInteger> {
+    static const uint32_t value = 7;
+    static const uint64_t modulus = 0;
+};
+
+template <>
+struct field_tag<complex> {
+    static const uint32_t value = 8;
+    static const uint64_t modulus = 0;
+};
+
+template <typename Field>
+MatrixFileHeader matrix_file_header(unsigned rows, unsigned cols) {
+    MatrixFileHeader header;
+    header.field = field_tag<Field>::value;
+    header.rows = rows;
+    header.cols = cols;
+    header.element_size = std::is_trivially_copyable<Field>::value ? sizeof(Field) : 0;
+    header.modulus = field_tag<Field>::modulus;
+    return header;
+}
+
+template <typename Field>
+bool matches_header(const MatrixFileHeader& header, bool tiled = false) {
+    MatrixFileHeader expected = matrix_file_header<Field>(0, 0);
+    return std::memcmp(header.magic, expected.magic, sizeof(header.magic)) == 0 &&
+           header.byte_order == expected.byte_order && header.field == expected.field &&
+           header.element_size == expected.element_size && header.modulus == expected.modulus &&
+           (header.tile != 0) == tiled;
+}
+
+// Payload size of a rows x cols file of element_size-byte elements. False if rows or cols do
+// not fit the unsigned accessors or the size overflows, so that a corrupt header cannot wrap
+// around the length checks.
+bool matrix_payload_bytes(uint64_t rows, uint64_t cols, uint64_t element_size, uint64_t& bytes) {
+    return rows <= std::numeric_limits<unsigned>::max() && cols <= std::numeric_limits<unsigned>::max() &&
+           !__builtin_mul_overflow(rows, cols, &bytes) && !__builtin_mul_overflow(bytes, element_size, &bytes);
+}
+
+// Payload size of a tiled file: whole tiles of tile x tile elements, padded past the edges.
+// False under the same conditions, or if the tile counts or the file offsets overflow.
+bool tiled_payload_bytes(uint64_t rows, uint64_t cols, uint64_t tile, uint64_t element_size, uint64_t& bytes) {
+    const uint64_t limit = std::numeric_limits<unsigned>::max();
+    if (tile == 0 || tile > limit || rows + tile - 1 > limit || cols + tile - 1 > limit)
+        return false;
+    const uint64_t padded_rows = (rows + tile - 1) / tile * tile;
+    const uint64_t padded_cols = (cols + tile - 1) / tile * tile;
+    return matrix_payload_bytes(padded_rows, padded_cols, element_size, bytes) &&
+           bytes <= static_cast<uint64_t>(std::numeric_limits<off_t>::max()) - sizeof(MatrixFileHeader);
+}
+
+void write_field(std::ostream& out, const BigInteger& x) {
+    uint32_t sign = x.sign();
+    uint32_t count = x.size();
+    out.write(reinterpret_cast<const char*>(&sign), sizeof(sign));
+    out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    for (uint32_t i = 0; i < count; ++i) {
+        uint32_t limb = x[i];
+        out.write(reinterpret_cast<const char*>(&limb), sizeof(limb));
+    }
+}
+
+void write_field(std::ostream& out, const Rational& x) {
+    write_field(out, x.numerator);
+    write_field(out, x.denominator);
+}
+
+bool read_field(std::istream& in, BigInteger& x) {
+    uint32_t sign = 0;
+    uint32_t count = 0;
+    in.read(reinterpret_cast<char*>(&sign), sizeof(sign));
+    in.read(reinterpret_cast<char*>(&count), sizeof(count));
+    x.clear();
+    for (uint32_t i = 0; i < count && in; ++i) {
+        uint32_t limb = 0;
+        in.read(reinterpret_cast<char*>(&limb), sizeof(limb));
+        x.push_back(limb);
+    }
+    x.sign() = sign;
+    x.shrink();
+    return static_cast<bool>(in);
+}
+
+bool read_field(std::istream& in, Rational& x) {
+    return read_field(in, x.numerator) && read_field(in, x.denominator);
+}
+
+// trivially copyable rows go out in a single write
+template <typename Field>
+void write_row(std::ostream& out, const std::vector<Field>& row, std::true_type) {
+    out.write(reinterpret_cast<const char*>(row.data()), row.size() * sizeof(Field));
+}
+
+template <typename Field>
+void write_row(std::ostream& out, const std::vector<Field>& row, std::false_type) {
+    for (const Field& x : row) {
+        write_field(out, x);
+    }
+}
+
+template <typename Field>
+bool read_row(std::istream& in, std::vector<Field>& row, std::true_type) {
+    in.read(reinterpret_cast<char*>(row.data()), row.size() * sizeof(Field));
+    return static_cast<bool>(in);
+}
+
+template <typename Field>
+bool read_row(std::istream& in, std::vector<Field>& row, std::false_type) {
+    for (Field& x : row) {
+        if (!read_field(in, x))
+            return false;
+    }
+    return true;
+}
+
+// Writes a matrix one row at a time, so a large matrix never has to be held in memory.
+template <typename Field>
+class MatrixWriter {
+private:
+    std::ofstream out;
+    unsigned rows_;
+    unsigned cols_;
+    unsigned written = 0;
+public:
+    MatrixWriter(const std::string& path, unsigned rows, unsigned cols):
+            out(path, std::ios::binary | std::ios::trunc), rows_(rows), cols_(cols) {
+        MatrixFileHeader header = matrix_file_header<Field>(rows, cols);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    }
+
+    bool good() const {
+        return static_cast<bool>(out);
+    }
+
+    void writeRow(const std::vector<Field>& row) {
+        assert(row.size() == cols_ && written < rows_);
+        write_row(out, row, std::is_trivially_copyable<Field>());
+        ++written;
+    }
+
+    // true if every row was written and reached the file
+    bool close() {
+        out.close();
+        return written == rows_ && static_cast<bool>(out);
+    }
+};
+
+// Reads a matrix file one row at a time. good() is false if the file could not be opened,
+// was written for another field or has a shape that does not fit in memory.
+template <typename Field>
+class MatrixReader {
+private:
+    std::ifstream in;
+    MatrixFileHeader header;
+    unsigned read = 0;
+public:
+    explicit MatrixReader(const std::string& path): in(path, std::ios::binary) {
+        in.read(reinterpret_cast<char*>(&header), sizeof(header));
+        uint64_t bytes;
+        if (in && (!matches_header<Field>(header) ||
+                   !matrix_payload_bytes(header.rows, header.cols, sizeof(Field), bytes)))
+            in.setstate(std::ios::failbit);
+    }
+
+    bool good() const {
+        return static_cast<bool>(in);
+    }
+    unsigned rows() const {
+        return header.rows;
+    }
+    unsigned cols() const {
+        return header.cols;
+    }
+
+    // false after the last row or on a read error
+    bool readRow(std::vector<Field>& row) {
+        if (!in || read == header.rows)
+            return false;
+        row.resize(header.cols);
+        ++read;
+        return read_row(in, row, std::is_trivially_copyable<Field>());
+    }
+};
+
+// Zero-copy view of a matrix file of a trivially copyable field: the file is mapped and
+// rows are pointers into the mapping, so loading costs no parsing and no copies until
+// a page is touched. Without mmap the payload is read into one contiguous buffer.
+template <typename Field>
+class MappedMatrix {
+private:
+    const char* data = nullptr;
+    size_t length = 0;
+    unsigned rows_ = 0;
+    unsigned cols_ = 0;
+    const Field* payload = nullptr;
+    std::vector<char> buffer;
+public:
+    explicit MappedMatrix(const std::string& path) {
+        compilation_error<std::is_trivially_copyable<Field>::value> check;
+        check = check;
+#if defined(__unix__) || defined(__APPLE__)
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return;
+        struct stat status;
+        if (fstat(fd, &status) == 0 && static_cast<size_t>(status.st_size) >= sizeof(MatrixFileHeader)) {
+            void* mapping = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping != MAP_FAILED) {
+                data = static_cast<const char*>(mapping);
+                length = status.st_size;
+            }
+        }
+        close(fd);
+#else
+        std::ifstream in(path, std::ios::binary);
+        buffer.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        data = buffer.data();
+        length = buffer.size();
+#endif
+        if (length < sizeof(MatrixFileHeader))
+            return;
+        MatrixFileHeader header;
+        std::memcpy(&header, data, sizeof(header));
+        uint64_t bytes;
+        if (!matches_header<Field>(header) ||
+            !matrix_payload_bytes(header.rows, header.cols, sizeof(Field), bytes) ||
+            length - sizeof(header) < bytes)
+            return;
+        rows_ = header.rows;
+        cols_ = header.cols;
+        payload = reinterpret_cast<const Field*>(data + sizeof(header));
+    }
+
+    MappedMatrix(const MappedMatrix&) = delete;
+    MappedMatrix& operator=(const MappedMatrix&) = delete;
+
+    ~MappedMatrix() {
+#if defined(__unix__) || defined(__APPLE__)
+        if (data != nullptr)
+            munmap(const_cast<char*>(data), length);
+#endif
+    }
+
+    bool good() const {
+        return payload != nullptr;
+    }
+    unsigned rows() const {
+        return rows_;
+    }
+    unsigned cols() const {
+        return cols_;
+    }
+
+    const Field* row(unsigned i) const {
+        return payload + static_cast<size_t>(i) * cols_;
+    }
+    const Field& at(unsigned i, unsigned j) const {
+        return row(i)[j];
+    }
+
+    DynamicMatrix<Field> toDynamic() const {
+        std::vector<std::vector<Field>> table(rows_);
+        for (unsigned i = 0; i < rows_; ++i) {
+            table[i].assign(row(i), row(i) + cols_);
+        }
+        return DynamicMatrix<Field>(table);
+    }
+};
+
+template <typename Field>
+bool save_matrix(const std::string& path, const DynamicMatrix<Field>& a) {
+    MatrixWriter<Field> writer(path, a.rows(), a.cols());
+    for (unsigned i = 0; i < a.rows(); ++i) {
+        writer.writeRow(a[i]);
+    }
+    return writer.close();
+}
+
+template <unsigned M, unsigned N, typename Field>
+bool save_matrix(const std::string& path, const Matrix<M, N, Field>& a) {
+    MatrixWriter<Field> writer(path, M, N);
+    for (unsigned i = 0; i < M; ++i) {
+        writer.writeRow(a[i]);
+    }
+    return writer.close();
+}
+
+template <typename Field>
+bool load_matrix(const std::string& path, DynamicMatrix<Field>& a) {
+    MatrixReader<Field> reader(path);
+    if (!reader.good())
+        return false;
+    std::vector<std::vector<Field>> table(reader.rows());
+    for (unsigned i = 0; i < reader.rows(); ++i) {
+        if (!reader.readRow(table[i]))
+            return false;
+    }
+    a = DynamicMatrix<Field>(table);
+    return true;
+}
+
+template <unsigned M, unsigned N, typename Field>
+bool load_matrix(const std::string& path, Matrix<M, N, Field>& a) {
+    MatrixReader<Field> reader(path);
+    if (!reader.good() || reader.rows() != M || reader.cols() != N)
+        return false;
+    for (unsigned i = 0; i < M; ++i) {
+        if (!reader.readRow(a[i]))
+            return false;
+    }
+    return true;
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+// Matrix file stored as square tiles, in row-major tile order after the header; edge tiles
+// are padded with zeros so that every tile has the same size and offset arithmetic. Tiles
+// are read and written with pread/pwrite, so several threads may use one file at a time.
+template <typename Field>
+class TiledMatrix {
+private:
+    int fd = -1;
+    unsigned rows_ = 0;
+    unsigned cols_ = 0;
+    unsigned tile_ = 0;
+
+    off_t tileOffset(unsigned bi, unsigned bj) const {
+        return sizeof(MatrixFileHeader) + (static_cast<off_t>(bi) * tileCols() + bj) * tileBytes();
+    }
+public:
+    // creates a file holding the zero matrix; the tiles are not written until they change
+    TiledMatrix(const std::string& path, unsigned rows, unsigned cols, unsigned tile):
+            rows_(rows), cols_(cols), tile_(tile) {
+        compilation_error<std::is_trivially_copyable<Field>::value> check;
+        check = check;
+        assert(tile > 0);
+        uint64_t bytes;
+        if (!tiled_payload_bytes(rows, cols, tile, sizeof(Field), bytes))
+            return;
+        fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0)
+            return;
+        MatrixFileHeader header = matrix_file_header<Field>(rows, cols);
+        header.tile = tile;
+        if (pwrite(fd, &header, sizeof(header), 0) != sizeof(header) ||
+            ftruncate(fd, tileOffset(tileRows(), 0)) != 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+
+    explicit TiledMatrix(const std::string& path) {
+        compilation_error<std::is_trivially_copyable<Field>::value> check;
+        check = check;
+        fd = open(path.c_str(), O_RDWR);
+        if (fd < 0)
+            return;
+        MatrixFileHeader header;
+        uint64_t bytes;
+        if (pread(fd, &header, sizeof(header), 0) != sizeof(header) || !matches_header<Field>(header, true) ||
+            !tiled_payload_bytes(header.rows, header.cols, header.tile, sizeof(Field), bytes)) {
+            close(fd);
+            fd = -1;
+            return;
+        }
+        rows_ = header.rows;
+        cols_ = header.cols;
+        tile_ = header.tile;
+    }
+
+    TiledMatrix(const TiledMatrix&) = delete;
+    TiledMatrix& operator=(const TiledMatrix&) = delete;
+
+    ~TiledMatrix() {
+        if (fd >= 0)
+            close(fd);
+    }
+
+    bool good() const {
+        return fd >= 0;
+    }
+    unsigned rows() const {
+        return rows_;
+    }
+    unsigned cols() const {
+        return cols_;
+    }
+    unsigned tile() const {
+        return tile_;
+    }
+    unsigned tileRows() const {
+        return (rows_ + tile_ - 1) / tile_;
+    }
+    unsigned tileCols() const {
+        return (cols_ + tile_ - 1) / tile_;
+    }
+    size_t tileBytes() const {
+        return static_cast<size_t>(tile_) * tile_ * sizeof(Field);
+    }
+
+    // t becomes a tile x tile table
+    bool readTile(unsigned bi, unsigned bj, std::vector<std::vector<Field>>& t) const {
+        std::vector<Field> flat(static_cast<size_t>(tile_) * tile_);
+        if (pread(fd, flat.data(), tileBytes(), tileOffset(bi, bj)) != static_cast<ssize_t>(tileBytes()))
+            return false;
+        t.resize(tile_);
+        for (unsigned i = 0; i < tile_; ++i) {
+            t[i].assign(flat.begin() + static_cast<size_t>(i) * tile_, flat.begin() + static_cast<size_t>(i + 1) * tile_);
+        }
+        return true;
+    }
+
+    bool writeTile(unsigned bi, unsigned bj, const std::vector<std::vector<Field>>& t) {
+        std::vector<Field> flat(static_cast<size_t>(tile_) * tile_);
+        for (unsigned i = 0; i < tile_; ++i) {
+            std::copy(t[i].begin(), t[i].end(), flat.begin() + static_cast<size_t>(i) * tile_);
+        }
+        return pwrite(fd, flat.data(), tileBytes(), tileOffset(bi, bj)) == static_cast<ssize_t>(tileBytes());
+    }
+
+    DynamicMatrix<Field> toDynamic() const {
+        DynamicMatrix<Field> result(rows_, cols_);
+        std::vector<std::vector<Field>> t;
+        for (unsigned bi = 0; bi < tileRows(); ++bi) {
+            for (unsigned bj = 0; bj < tileCols(); ++bj) {
+                readTile(bi, bj, t);
+                for (unsigned i = 0; i < tile_ && bi * tile_ + i < rows_; ++i) {
+                    for (unsigned j = 0; j < tile_ && bj * tile_ + j < cols_; ++j) {
+                        result[bi * tile_ + i][bj * tile_ + j] = t[i][j];
+                    }
+                }
+            }
+        }
+        return result;
+    }
+};
+
+// Retiles a row-major matrix file written by MatrixWriter, holding one band of tile rows
+// in memory at a time.
+template <typename Field>
+bool convert_to_tiled(const std::string& from, const std::string& to, unsigned tile) {
+    MatrixReader<Field> reader(from);
+    if (!reader.good())
+        return false;
+    TiledMatrix<Field> result(to, reader.rows(), reader.cols(), tile);
+    if (!result.good())
+        return false;
+    std::vector<std::vector<Field>> band(tile);
+    std::vector<std::vector<Field>> t(tile, std::vector<Field>(tile));
+    for (unsigned bi = 0; bi < result.tileRows(); ++bi) {
+        for (unsigned i = 0; i < tile; ++i) {
+            if (bi * tile + i >= reader.rows())
+                band[i].assign(reader.cols(), Field(0));
+            else if (!reader.readRow(band[i]))
+                return false;
+        }
+        for (unsigned bj = 0; bj < result.tileCols(); ++bj) {
+            for (unsigned i = 0; i < tile; ++i) {
+                for (unsigned j = 0; j < tile; ++j) {
+                    unsigned col = bj * tile + j;
+                    t[i][j] = col < reader.cols() ? band[i][col] : Field(0);
+                }
+            }
+            if (!result.writeTile(bi, bj, t))
+                return false;
+        }
+    }
+    return true;
+}
+
+struct OutOfCoreStats {
+    // false if a tile could not be read or written
+    bool ok = true;
+    uint64_t bytes_read = 0;
+    uint64_t bytes_written = 0;
+    // time spent in pread/pwrite, mostly overlapped with compute
+    double io_seconds = 0;
+    // time spent in the tile kernels
+    double compute_seconds = 0;
+    // time compute waited for a prefetch that had not finished
+    double stall_seconds = 0;
+    double wall_seconds = 0;
+
+    // bytes per second while doing I/O
+    double bandwidth() const {
+        return io_seconds > 0 ? (bytes_read + bytes_written) / io_seconds : 0;
+    }
+    // fraction of the wall time spent computing
+    double utilization() const {
+        return wall_seconds > 0 ? compute_seconds / wall_seconds : 0;
+    }
+};
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// c = a * b for tiled files sharing one tile size, using at most about memory_budget bytes
+// of tiles. A block of s x s tiles of c stays resident while, for every k, the panels
+// a(block rows, k) and b(k, block cols) stream past it; the panel for k + 1 is read by a
+// prefetch thread while the products for k run, so with s^2 + 4s + 1 tiles in memory each
+// tile of a and b is read once per block instead of once per tile of c. Tile products go
+// through multiply_kernel and get the same Strassen and Residue paths as in-memory ones.
+template <typename Field>
+OutOfCoreStats out_of_core_multiply(const TiledMatrix<Field>& a, const TiledMatrix<Field>& b,
+                                    TiledMatrix<Field>& c, size_t memory_budget) {
+    assert(a.cols() == b.rows() && c.rows() == a.rows() && c.cols() == b.cols());
+    assert(a.tile() == b.tile() && a.tile() == c.tile());
+    typedef std::vector<std::vector<Field>> Tile;
+    struct Panel {
+        std::vector<Tile> a;
+        std::vector<Tile> b;
+        bool ok = true;
+        double seconds = 0;
+    };
+    unsigned tile = a.tile();
+    size_t budget_tiles = memory_budget / a.tileBytes();
+    assert(budget_tiles >= 6);
+    unsigned side = 1;
+    while ((side + 1) * (side + 1) + 4 * (side + 1) + 1 <= budget_tiles) {
+        ++side;
+    }
+    OutOfCoreStats stats;
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned bi0 = 0; bi0 < c.tileRows(); bi0 += side) {
+        for (unsigned bj0 = 0; bj0 < c.tileCols(); bj0 += side) {
+            unsigned block_rows = std::min(side, c.tileRows() - bi0);
+            unsigned block_cols = std::min(side, c.tileCols() - bj0);
+            auto load = [&a, &b, bi0, bj0, block_rows, block_cols](unsigned k) {
+                auto io_start = std::chrono::steady_clock::now();
+                Panel panel;
+                panel.a.resize(block_rows);
+                panel.b.resize(block_cols);
+                for (unsigned i = 0; i < block_rows; ++i) {
+                    panel.ok &= a.readTile(bi0 + i, k, panel.a[i]);
+                }
+                for (unsigned j = 0; j < block_cols; ++j) {
+                    panel.ok &= b.readTile(k, bj0 + j, panel.b[j]);
+                }
+                panel.seconds = seconds_since(io_start);
+                return panel;
+            };
+            std::vector<std::vector<Tile>> block(block_rows, std::vector<Tile>(block_cols,
+                    Tile(tile, std::vector<Field>(tile, Field(0)))));
+            std::future<Panel> next = std::async(std::launch::async, load, 0);
+            for (unsigned k = 0; k < a.tileCols(); ++k) {
+                auto wait_start = std::chrono::steady_clock::now();
+                Panel panel = next.get();
+                stats.stall_seconds += seconds_since(wait_start);
+                if (!panel.ok) {
+                    stats.ok = false;
+                    return stats;
+                }
+                stats.io_seconds += panel.seconds;
+                stats.bytes_read += (block_rows + block_cols) * a.tileBytes();
+                if (k + 1 < a.tileCols())
+                    next = std::async(std::launch::async, load, k + 1);
+                auto compute_start = std::chrono::steady_clock::now();
+                for (unsigned i = 0; i < block_rows; ++i) {
+                    for (unsigned j = 0; j < block_cols; ++j) {
+                        Tile product = multiply_kernel(panel.a[i], panel.b[j], tile, tile, tile);
+                        Tile& target = block[i][j];
+                        for (unsigned x = 0; x < tile; ++x) {
+                            for (unsigned y = 0; y < tile; ++y) {
+                                target[x][y] += product[x][y];
+                            }
+                        }
+                    }
+                }
+                stats.compute_seconds += seconds_since(compute_start);
+            }
+            auto io_start = std::chrono::steady_clock::now();
+            for (unsigned i = 0; i < block_rows; ++i) {
+                for (unsigned j = 0; j < block_cols; ++j) {
+                    stats.ok &= c.writeTile(bi0 + i, bj0 + j, block[i][j]);
+                }
+            }
+            stats.io_seconds += seconds_since(io_start);
+            stats.bytes_written += block_rows * block_cols * c.tileBytes();
+        }
+    }
+    stats.wall_seconds = seconds_since(start);
+    return stats;
+}
+#endif
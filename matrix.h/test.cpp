@@ -0,0 +1,6 @@
+#include "test_matrix.h"
+
+int main() {
+    testingFunction();
+    return 0;
+}
@@ -0,0 +1,1059 @@
+#ifndef MATRIX_H__TEST_MATRIX_H_
+#define MATRIX_H__TEST_MATRIX_H_
+
+#include "matrix.h"
+#include <cassert>
+#include <random>
+
+// Reference implementations: textbook definitions, no pivoting tricks, no blocking.
+template <typename Field>
+std::vector<std::vector<Field>> naive_multiply(const std::vector<std::vector<Field>>& a,
+                                               const std::vector<std::vector<Field>>& b) {
+    std::vector<std::vector<Field>> c(a.size(), std::vector<Field>(b[0].size()));
+    for (size_t i = 0; i < a.size(); ++i) {
+        for (size_t j = 0; j < b[0].size(); ++j) {
+            for (size_t k = 0; k < b.size(); ++k) {
+                c[i][j] += a[i][k] * b[k][j];
+            }
+        }
+    }
+    return c;
+}
+
+template <unsigned M, unsigned N, typename Field>
+std::vector<std::vector<Field>> table_of(const Matrix<M, N, Field>& a) {
+    std::vector<std::vector<Field>> t(M);
+    for (unsigned i = 0; i < M; ++i) {
+        t[i] = a.getRow(i);
+    }
+    return t;
+}
+
+template <typename Field>
+std::vector<std::vector<Field>> table_of(const DynamicMatrix<Field>& a) {
+    std::vector<std::vector<Field>> t;
+    for (unsigned i = 0; i < a.rows(); ++i) {
+        t.push_back(a[i]);
+    }
+    return t;
+}
+
+// Laplace expansion along the first row
+template <typename Field>
+Field laplace_det(const std::vector<std::vector<Field>>& a) {
+    if (a.size() == 1)
+        return a[0][0];
+    Field result(0);
+    for (size_t j = 0; j < a.size(); ++j) {
+        std::vector<std::vector<Field>> minor;
+        for (size_t i = 1; i < a.size(); ++i) {
+            minor.push_back(a[i]);
+            minor.back().erase(minor.back().begin() + j);
+        }
+        Field term = a[0][j] * laplace_det(minor);
+        if (j % 2 == 0)
+            result += term;
+        else
+            result -= term;
+    }
+    return result;
+}
+
+// the size of the largest non-vanishing minor
+template <typename Field>
+unsigned minor_rank(const std::vector<std::vector<Field>>& a) {
+    const unsigned rows = a.size();
+    const unsigned cols = a[0].size();
+    for (unsigned k = std::min(rows, cols); k > 0; --k) {
+        for (unsigned row_mask = 0; row_mask < (1u << rows); ++row_mask) {
+            if (static_cast<unsigned>(__builtin_popcount(row_mask)) != k)
+                continue;
+            for (unsigned col_mask = 0; col_mask < (1u << cols); ++col_mask) {
+                if (static_cast<unsigned>(__builtin_popcount(col_mask)) != k)
+                    continue;
+                std::vector<std::vector<Field>> minor;
+                for (unsigned i = 0; i < rows; ++i) {
+                    if (!(row_mask >> i & 1))
+                        continue;
+                    minor.emplace_back();
+                    for (unsigned j = 0; j < cols; ++j) {
+                        if (col_mask >> j & 1)
+                            minor.back().push_back(a[i][j]);
+                    }
+                }
+                if (laplace_det(minor) != Field(0))
+                    return k;
+            }
+        }
+    }
+    return 0;
+}
+
+template <typename Field>
+std::vector<std::vector<Field>> identity_table(unsigned n) {
+    std::vector<std::vector<Field>> e(n, std::vector<Field>(n));
+    for (unsigned i = 0; i < n; ++i) {
+        e[i][i] = Field(1);
+    }
+    return e;
+}
+
+template <unsigned M, unsigned N, typename Field>
+Matrix<M, N, Field> random_matrix(std::mt19937& rnd, int range = 1000) {
+    Matrix<M, N, Field> a;
+    for (unsigned i = 0; i < M; ++i) {
+        for (unsigned j = 0; j < N; ++j) {
+            a[i][j] = Field(static_cast<int>(rnd() % (2 * range + 1)) - range);
+        }
+    }
+    return a;
+}
+
+void multiplyTest() {
+    std::cout << "Multiply tests: \n";
+    std::mt19937 rnd(39);
+
+    Matrix<5, 7, Rational> a = random_matrix<5, 7, Rational>(rnd);
+    Matrix<7, 3, Rational> b = random_matrix<7, 3, Rational>(rnd);
+    assert(table_of(a * b) == naive_multiply(table_of(a), table_of(b)));
+    std::cout << "Ok! Small rational multiply matches the definition\n";
+
+    // above MATRIX_STRASSEN_THRESHOLD, rectangular and not a power of two
+    const unsigned P = 1000000007;
+    Matrix<70, 90, Residue<P>> c = random_matrix<70, 90, Residue<P>>(rnd);
+    Matrix<90, 130, Residue<P>> d = random_matrix<90, 130, Residue<P>>(rnd);
+    std::vector<std::vector<Residue<P>>> expected = naive_multiply(table_of(c), table_of(d));
+    assert(table_of(c * d) == expected);
+    assert(table_of(strassen(c, d)) == expected);
+    std::cout << "Ok! Strassen and the threshold dispatch match the definition\n";
+
+    Matrix<66, 66, double> e = random_matrix<66, 66, double>(rnd, 8);
+    Matrix<66, 66, double> f = random_matrix<66, 66, double>(rnd, 8);
+    assert(table_of(strassen(e, f)) == naive_multiply(table_of(e), table_of(f)));
+    std::cout << "Ok! Small integers multiply exactly in double\n";
+}
+
+void luTest() {
+    std::cout << "LU tests: \n";
+    std::mt19937 rnd(26);
+
+    for (int t = 0; t < 20; ++t) {
+        Matrix<5, 5, Rational> a = random_matrix<5, 5, Rational>(rnd, 9);
+        // a zero corner forces a row exchange on the first step
+        a[0][0] = Rational(0);
+        LU<5, Rational> lu(a);
+        Rational expected = laplace_det(table_of(a));
+        assert(lu.det() == expected);
+        assert(a.det() == expected);
+        if (expected == Rational(0))
+            continue;
+        assert(lu.rank() == 5);
+
+        Matrix<5, 2, Rational> b = random_matrix<5, 2, Rational>(rnd);
+        assert(table_of(a * lu.solve(b)) == table_of(b));
+        std::vector<Rational> column = b.getColumn(0);
+        std::vector<Rational> x = lu.solve(column);
+        for (unsigned i = 0; i < 5; ++i) {
+            Rational row(0);
+            for (unsigned j = 0; j < 5; ++j) {
+                row += a[i][j] * x[j];
+            }
+            assert(row == column[i]);
+        }
+        assert(table_of(a * lu.inverse()) == identity_table<Rational>(5));
+        assert(table_of(a * a.inverted()) == identity_table<Rational>(5));
+    }
+    std::cout << "Ok! det matches the Laplace expansion, solve and inverse satisfy A x = b\n";
+
+    // odd and even permutations of the identity
+    Matrix<2, 2, Rational> swap = {{0, 1}, {1, 0}};
+    Matrix<3, 3, Rational> cycle = {{0, 1, 0}, {0, 0, 1}, {1, 0, 0}};
+    Matrix<4, 4, Rational> two_swaps = {{0, 1, 0, 0}, {1, 0, 0, 0}, {0, 0, 0, 1}, {0, 0, 1, 0}};
+    assert(LU<2>(swap).det() == Rational(-1));
+    assert(LU<3>(cycle).det() == Rational(1));
+    assert(LU<4>(two_swaps).det() == Rational(1));
+    assert(swap.det() == Rational(-1));
+    std::cout << "Ok! Row exchanges flip the sign of det\n";
+
+    // the last row is the sum of the first two
+    Matrix<4, 4, Rational> singular = {{1, 2, 3, 4}, {0, 5, 1, 2}, {1, 7, 4, 6}, {3, 1, 4, 1}};
+    LU<4, Rational> lu(singular);
+    assert(lu.det() == Rational(0));
+    assert(lu.rank() == 3);
+    assert(singular.rank() == 3);
+    std::cout << "Ok! Singular matrices have det 0 and the right rank\n";
+
+    Matrix<6, 6, double> d = random_matrix<6, 6, double>(rnd, 5);
+    double expected = laplace_det(table_of(d));
+    assert(std::abs(LU<6, double>(d).det() - expected) <= 1e-9 * std::max(1.0, std::abs(expected)));
+    std::cout << "Ok! Partial pivoting in double agrees with the Laplace expansion\n";
+}
+
+void expressionTest() {
+    std::cout << "Expression template tests: \n";
+    std::mt19937 rnd(27);
+
+    Matrix<4, 6, Rational> a = random_matrix<4, 6, Rational>(rnd);
+    Matrix<4, 6, Rational> b = random_matrix<4, 6, Rational>(rnd);
+    Matrix<4, 6, Rational> c = random_matrix<4, 6, Rational>(rnd);
+    Rational k(7);
+    std::vector<std::vector<Rational>> expected = table_of(a);
+    for (unsigned i = 0; i < 4; ++i) {
+        for (unsigned j = 0; j < 6; ++j) {
+            expected[i][j] = a[i][j] + b[i][j] - c[i][j] * k;
+        }
+    }
+    Matrix<4, 6, Rational> d = a + b - c * k;
+    assert(table_of(d) == expected);
+    assert(table_of((a + b - k * c).eval()) == expected);
+    assert(a + b - c * k == d);
+    assert(a + b != d);
+
+    Matrix<4, 6, Rational> e = a;
+    e += b - c * k;
+    assert(table_of(e) == expected);
+    e -= b - c * k;
+    assert(e == a);
+    std::cout << "Ok! Lazy +, - and scalar * match the element-wise definition\n";
+
+    // the destination is also an operand
+    Matrix<4, 6, Rational> f = a;
+    f = f + f * k;
+    assert(f == a * Rational(8));
+    Matrix<3, 3, Rational> g = {{1, 2, 3}, {4, 5, 6}, {7, 8, 9}};
+    Matrix<3, 3, Rational> symmetric = {{2, 6, 10}, {6, 10, 14}, {10, 14, 18}};
+    g = g.transposedView() + g;
+    assert(g == symmetric);
+    std::cout << "Ok! Assignments over their own operands are evaluated correctly\n";
+
+    // a product with a lazy operand
+    Matrix<6, 2, Rational> h = random_matrix<6, 2, Rational>(rnd);
+    assert(table_of((a + b) * h) == naive_multiply(table_of(Matrix<4, 6, Rational>(a + b)), table_of(h)));
+    std::cout << "Ok! Products materialize lazy operands\n";
+}
+
+void dynamicMatrixTest() {
+    std::cout << "DynamicMatrix tests: \n";
+    std::mt19937 rnd(28);
+
+    Matrix<5, 5, Rational> a = random_matrix<5, 5, Rational>(rnd, 20);
+    Matrix<5, 3, Rational> b = random_matrix<5, 3, Rational>(rnd, 20);
+    DynamicMatrix<Rational> da(a);
+    DynamicMatrix<Rational> db(b);
+    assert(da.rows() == 5 && da.cols() == 5);
+    assert((da.toMatrix<5, 5>() == a));
+
+    assert(table_of(da * db) == table_of(a * b));
+    assert(table_of(da + da * Rational(3) - da) == table_of(Matrix<5, 5, Rational>(a * Rational(3))));
+    assert(table_of(db.transposed()) == table_of(b.transposed()));
+    assert(table_of(da.getGauss()) == table_of(a.getGauss()));
+    assert(da.rank() == a.rank());
+    assert(da.det() == laplace_det(table_of(a)));
+    assert(da.trace() == a.trace());
+    assert(table_of(da.pow(5)) == table_of(a.pow(5)));
+    assert(da.charpoly() == a.charpoly());
+    if (da.det() != Rational(0)) {
+        assert(table_of(da.inverted()) == table_of(a.inverted()));
+        assert(table_of(da * da.solve(db)) == table_of(db));
+    }
+    std::cout << "Ok! DynamicMatrix agrees with Matrix<M, N> on every shared operation\n";
+
+    DynamicMatrix<Rational> wide = {{1, 2, 3, 4}, {2, 4, 6, 8}};
+    assert(wide.rows() == 2 && wide.cols() == 4);
+    assert(wide.rank() == 1);
+    std::cout << "Ok! Runtime shapes come from the initializer\n";
+}
+
+template <typename Field>
+DynamicMatrix<Field> random_sparse(std::mt19937& rnd, unsigned n, unsigned percent) {
+    DynamicMatrix<Field> a(n, n);
+    for (unsigned i = 0; i < n; ++i) {
+        for (unsigned j = 0; j < n; ++j) {
+            if (rnd() % 100 < percent)
+                a[i][j] = Field(static_cast<int>(rnd() % 19) - 9);
+        }
+    }
+    return a;
+}
+
+void sparseTest() {
+    std::cout << "Sparse tests: \n";
+    std::mt19937 rnd(29);
+
+    SparseMatrix<Rational> s(2, 3, {{1, 2, Rational(4)}, {0, 1, Rational(2)}, {1, 2, Rational(-4)}, {0, 1, Rational(3)}});
+    assert(s.nonZeros() == 1);
+    assert(s.get(0, 1) == Rational(5));
+    assert(s.get(1, 2) == Rational(0));
+    std::cout << "Ok! Duplicates are summed and zeros dropped\n";
+
+    unsigned solved = 0;
+    for (int t = 0; t < 30; ++t) {
+        const unsigned n = 14;
+        DynamicMatrix<Rational> dense = random_sparse<Rational>(rnd, n, t % 2 == 0 ? 12 : 25);
+        if (t % 3 == 0) {
+            // a dependent row
+            for (unsigned j = 0; j < n; ++j) {
+                dense[n - 1][j] = dense[0][j] - dense[1][j];
+            }
+        }
+        SparseMatrix<Rational> a(dense);
+        assert(table_of(a.toDense()) == table_of(dense));
+        assert(table_of(a.transposed().toDense()) == table_of(dense.transposed()));
+
+        std::vector<Rational> x(n);
+        for (unsigned i = 0; i < n; ++i) {
+            x[i] = Rational(static_cast<int>(rnd() % 21) - 10);
+        }
+        DynamicMatrix<Rational> column(n, 1);
+        for (unsigned i = 0; i < n; ++i) {
+            column[i][0] = x[i];
+        }
+        std::vector<Rational> b = a * x;
+        assert(b == (dense * column).getColumn(0));
+
+        SparseLU<Rational> lu(a);
+        assert(lu.rank() == LUFactorization<Rational>(table_of(dense), n).rank());
+        assert(lu.det() == dense.det());
+        assert(a.det() == dense.det());
+        if (lu.rank() == n) {
+            assert(lu.solve(b) == x);
+            assert(a.solve(b) == x);
+            ++solved;
+        }
+    }
+    assert(solved > 0);
+    std::cout << "Ok! Sparse LU agrees with dense elimination on rank, det and solve\n";
+
+    // long enough that a scan over all rows and columns per pivot would dominate
+    typedef Residue<998244353> R;
+    const unsigned m = 20000;
+    std::vector<std::tuple<unsigned, unsigned, R>> band;
+    std::vector<R> y(m);
+    for (unsigned i = 0; i < m; ++i) {
+        band.emplace_back(i, i, R(4));
+        if (i + 1 < m) {
+            band.emplace_back(i, i + 1, R(1));
+            band.emplace_back(i + 1, i, R(1));
+        }
+        y[i] = R(static_cast<int>(rnd() % 1000));
+    }
+    SparseMatrix<R> tridiagonal(m, m, std::move(band));
+    SparseLU<R> band_lu(tridiagonal);
+    assert(band_lu.rank() == m);
+    assert(band_lu.solve(tridiagonal * y) == y);
+    std::cout << "Ok! A tridiagonal system with 20000 unknowns is solved\n";
+}
+
+void gaussTest() {
+    std::cout << "Gauss tests: \n";
+    std::mt19937 rnd(30);
+
+    for (int t = 0; t < 40; ++t) {
+        // rank at most 3, and sometimes a zero column that must be skipped
+        Matrix<5, 3, Rational> left = random_matrix<5, 3, Rational>(rnd, 3);
+        Matrix<3, 6, Rational> right = random_matrix<3, 6, Rational>(rnd, 3);
+        Matrix<5, 6, Rational> a = left * right;
+        if (t % 2 == 0) {
+            for (unsigned i = 0; i < 5; ++i) {
+                a[i][t % 6] = Rational(0);
+            }
+        }
+        unsigned expected = minor_rank(table_of(a));
+        assert(a.rank() == expected);
+        assert(a.transposed().rank() == expected);
+
+        // reduced echelon form: leading entries move right, pivot columns are otherwise zero
+        Matrix<5, 6, Rational> g = a.getGauss();
+        unsigned nonzero_rows = 0;
+        unsigned last_lead = 0;
+        for (unsigned i = 0; i < 5; ++i) {
+            unsigned lead = 0;
+            while (lead < 6 && g[i][lead] == Rational(0)) {
+                ++lead;
+            }
+            if (lead == 6)
+                continue;
+            assert(i == nonzero_rows);
+            assert(nonzero_rows == 0 || lead > last_lead);
+            for (unsigned k = 0; k < 5; ++k) {
+                assert(k == i || g[k][lead] == Rational(0));
+            }
+            last_lead = lead;
+            ++nonzero_rows;
+        }
+        assert(nonzero_rows == expected);
+
+        // same row space: appending the rows of a to g adds nothing
+        std::vector<std::vector<Rational>> stacked = table_of(g);
+        for (unsigned i = 0; i < 5; ++i) {
+            stacked.push_back(a.getRow(i));
+        }
+        assert(DynamicMatrix<Rational>(stacked).rank() == expected);
+    }
+    std::cout << "Ok! getGauss gives the reduced echelon form and rank the minor rank\n";
+
+    // the baseline treated every |x| < 1 as zero
+    Matrix<3, 3, double> d = {{0, 1, 1}, {1, 1, 1}, {2, 2, 2}};
+    d[0][0] = 1e-3;
+    assert(d.rank() == 2);
+    Matrix<2, 5, Residue<7>> wide = {{1, 2, 3, 4, 5}, {0, 0, 0, 1, 6}};
+    assert(wide.rank() == 2);
+    Matrix<3, 3, BigInteger> integers = {{2, 4, 6}, {1, 3, 5}, {3, 7, 11}};
+    assert(integers.rank() == 2);
+    std::cout << "Ok! rank for double, residues and BigInteger\n";
+}
+
+void powerTest() {
+    std::cout << "Power tests: \n";
+    std::mt19937 rnd(31);
+    const unsigned P = 1000000007;
+
+    Matrix<4, 4, Residue<P>> a = random_matrix<4, 4, Residue<P>>(rnd);
+    std::vector<std::vector<Residue<P>>> expected = identity_table<Residue<P>>(4);
+    for (unsigned k = 0; k <= 12; ++k) {
+        assert(table_of(a.pow(k)) == expected);
+        assert(table_of(DynamicMatrix<Residue<P>>(a).pow(k)) == expected);
+        expected = naive_multiply(expected, table_of(a));
+    }
+    Matrix<70, 70, Residue<P>> b = random_matrix<70, 70, Residue<P>>(rnd);
+    assert(table_of(b.pow(3)) == naive_multiply(naive_multiply(table_of(b), table_of(b)), table_of(b)));
+    std::cout << "Ok! pow matches repeated multiplication below and above the Strassen threshold\n";
+
+    // a[n] = 2 a[n-1] - a[n-2] + 5 a[n-3]
+    std::vector<Residue<P>> c = {Residue<P>(2), Residue<P>(-1), Residue<P>(5)};
+    std::vector<Residue<P>> terms = {Residue<P>(1), Residue<P>(4), Residue<P>(-3)};
+    for (unsigned n = 3; n < 300; ++n) {
+        terms.push_back(c[0] * terms[n - 1] + c[1] * terms[n - 2] + c[2] * terms[n - 3]);
+    }
+    std::vector<Residue<P>> initial(terms.begin(), terms.begin() + 3);
+    for (unsigned k = 0; k < 300; ++k) {
+        assert(linear_recurrence_term(c, initial, k) == terms[k]);
+    }
+
+    // Fibonacci numbers far out, against the power of the companion matrix
+    Matrix<2, 2, Residue<P>> fibonacci = {{1, 1}, {1, 0}};
+    std::vector<Residue<P>> one_one = {Residue<P>(1), Residue<P>(1)};
+    std::vector<Residue<P>> zero_one = {Residue<P>(0), Residue<P>(1)};
+    for (unsigned long long k : {1000000000000000000ULL, 123456789123ULL, 77ULL}) {
+        assert(linear_recurrence_term(one_one, zero_one, k) == fibonacci.pow(k)[0][1]);
+    }
+    std::cout << "Ok! Kitamasa matches the recurrence and the companion matrix power\n";
+}
+
+// reference product on raw values, reduced after every term
+template <unsigned P, unsigned M, unsigned K, unsigned N>
+bool matches_raw_product(const Matrix<M, K, Residue<P>>& a, const Matrix<K, N, Residue<P>>& b,
+                         const Matrix<M, N, Residue<P>>& c) {
+    for (unsigned i = 0; i < M; ++i) {
+        for (unsigned j = 0; j < N; ++j) {
+            unsigned long long sum = 0;
+            for (unsigned t = 0; t < K; ++t) {
+                sum = (sum + 1ULL * static_cast<int>(a.at(i, t)) * static_cast<int>(b.at(t, j))) % P;
+            }
+            if (sum != static_cast<unsigned long long>(static_cast<int>(c.at(i, j))))
+                return false;
+        }
+    }
+    return true;
+}
+
+template <unsigned P>
+void lazyMultiplyTest(std::mt19937& rnd) {
+    // every entry P - 1: the accumulators reach their bound between two reductions
+    Matrix<3, 100, Residue<P>> worst_a;
+    Matrix<100, 5, Residue<P>> worst_b;
+    for (unsigned t = 0; t < 100; ++t) {
+        for (unsigned i = 0; i < 3; ++i) {
+            worst_a[i][t] = Residue<P>(-1);
+        }
+        for (unsigned j = 0; j < 5; ++j) {
+            worst_b[t][j] = Residue<P>(-1);
+        }
+    }
+    assert((matches_raw_product<P>(worst_a, worst_b, worst_a * worst_b)));
+
+    Matrix<9, 77, Residue<P>> a = random_matrix<9, 77, Residue<P>>(rnd, 1 << 29);
+    Matrix<77, 13, Residue<P>> b = random_matrix<77, 13, Residue<P>>(rnd, 1 << 29);
+    assert((matches_raw_product<P>(a, b, a * b)));
+}
+
+void residueMultiplyTest() {
+    std::cout << "Residue multiply tests: \n";
+    std::mt19937 rnd(32);
+
+    lazyMultiplyTest<2>(rnd);
+    lazyMultiplyTest<10007>(rnd);
+    lazyMultiplyTest<998244353>(rnd);
+    lazyMultiplyTest<2147483647>(rnd);
+    std::cout << "Ok! The lazily reduced kernel matches term-by-term reduction\n";
+}
+
+template <typename Field>
+std::vector<std::vector<Field>> naive_transpose(const std::vector<std::vector<Field>>& a) {
+    std::vector<std::vector<Field>> t(a[0].size(), std::vector<Field>(a.size()));
+    for (size_t i = 0; i < a.size(); ++i) {
+        for (size_t j = 0; j < a[0].size(); ++j) {
+            t[j][i] = a[i][j];
+        }
+    }
+    return t;
+}
+
+void transposeTest() {
+    std::cout << "Transpose tests: \n";
+    std::mt19937 rnd(33);
+
+    // many MATRIX_TRANSPOSE_BLOCK leaves, odd sides so the recursion splits unevenly
+    Matrix<151, 67, double> a = random_matrix<151, 67, double>(rnd);
+    assert(table_of(a.transposed()) == naive_transpose(table_of(a)));
+    assert(table_of(a.transposedView().eval()) == naive_transpose(table_of(a)));
+
+    Matrix<97, 97, double> b = random_matrix<97, 97, double>(rnd);
+    Matrix<97, 97, double> c = b;
+    c.transpose();
+    assert(table_of(c) == naive_transpose(table_of(b)));
+    c.transpose();
+    assert(c == b);
+
+    DynamicMatrix<Rational> d(random_matrix<23, 41, Rational>(rnd));
+    std::vector<std::vector<Rational>> expected = naive_transpose(table_of(d));
+    assert(table_of(d.transposed()) == expected);
+    d.transpose();
+    assert(d.rows() == 41 && d.cols() == 23);
+    assert(table_of(d) == expected);
+
+    // the in-place kernel honours the leaf size it is given, down to single elements
+    for (unsigned block : {1, 7, 64, 100000}) {
+        std::vector<std::vector<double>> g = table_of(b);
+        transpose_in_place_kernel(g, 0, 97, block);
+        assert(g == naive_transpose(table_of(b)));
+    }
+    std::cout << "Ok! transposed, transpose and the transposed view match the definition\n";
+
+    // A^T B through the view, without materializing A^T
+    Matrix<30, 20, Rational> e = random_matrix<30, 20, Rational>(rnd);
+    Matrix<30, 10, Rational> f = random_matrix<30, 10, Rational>(rnd);
+    assert(table_of(e.transposedView() * f) == naive_multiply(naive_transpose(table_of(e)), table_of(f)));
+    std::cout << "Ok! Products with the transposed view match A^T B\n";
+}
+
+template <unsigned N>
+void smallMatrixTest(std::mt19937& rnd) {
+    for (int t = 0; t < 20; ++t) {
+        Matrix<N, N, Rational> a = random_matrix<N, N, Rational>(rnd, 6);
+        Rational expected = laplace_det(table_of(a));
+        assert(a.det() == expected);
+        assert(DynamicMatrix<Rational>(a).det() == expected);
+        if (expected == Rational(0))
+            continue;
+        assert(table_of(a * a.inverted()) == identity_table<Rational>(N));
+        assert(table_of(DynamicMatrix<Rational>(a).inverted()) == table_of(a.inverted()));
+    }
+}
+
+template <unsigned N>
+void batchTest(std::mt19937& rnd) {
+    const unsigned W = 8;
+    MatrixBatch<N, Rational, W> a;
+    MatrixBatch<N, Rational, W> b;
+    std::vector<Matrix<N, N, Rational>> lanes_a;
+    std::vector<Matrix<N, N, Rational>> lanes_b;
+    for (unsigned w = 0; w < W; ++w) {
+        lanes_a.push_back(random_matrix<N, N, Rational>(rnd, 6));
+        lanes_b.push_back(random_matrix<N, N, Rational>(rnd, 6));
+        // the diagonal keeps every lane invertible
+        for (unsigned i = 0; i < N; ++i) {
+            lanes_a[w][i][i] = Rational(50 + w);
+        }
+        a.load(w, lanes_a[w]);
+        b.load(w, lanes_b[w]);
+    }
+    MatrixBatch<N, Rational, W> product = a * b;
+    MatrixBatch<N, Rational, W> inverse = a.inverted();
+    std::array<Rational, W> det = a.det();
+    for (unsigned w = 0; w < W; ++w) {
+        assert(a.extract(w) == lanes_a[w]);
+        assert(table_of(product.extract(w)) == naive_multiply(table_of(lanes_a[w]), table_of(lanes_b[w])));
+        assert(det[w] == laplace_det(table_of(lanes_a[w])));
+        assert(table_of(lanes_a[w] * inverse.extract(w)) == identity_table<Rational>(N));
+    }
+
+    MatrixBatch<N, double, W> d;
+    for (unsigned w = 0; w < W; ++w) {
+        d.load(w, random_matrix<N, N, double>(rnd, 6));
+    }
+    std::array<double, W> d_det = d.det();
+    for (unsigned w = 0; w < W; ++w) {
+        // small integers: every cofactor term is exact in double
+        assert(d_det[w] == laplace_det(table_of(d.extract(w))));
+    }
+}
+
+void smallMatrixTests() {
+    std::cout << "Small matrix tests: \n";
+    std::mt19937 rnd(34);
+
+    smallMatrixTest<1>(rnd);
+    smallMatrixTest<2>(rnd);
+    smallMatrixTest<3>(rnd);
+    smallMatrixTest<4>(rnd);
+    std::cout << "Ok! Closed-form det and inverse for n <= 4 match the Laplace expansion\n";
+
+    batchTest<2>(rnd);
+    batchTest<3>(rnd);
+    batchTest<4>(rnd);
+    std::cout << "Ok! Every MatrixBatch lane matches the matrix it was loaded from\n";
+}
+
+// the exact value of a finite double
+Rational exact_rational(double x) {
+    int exponent = 0;
+    long long mantissa = static_cast<long long>(std::ldexp(std::frexp(x, &exponent), 53));
+    exponent -= 53;
+    Rational result = Rational(BigInteger(mantissa));
+    for (; exponent > 0; --exponent) {
+        result *= Rational(2);
+    }
+    for (; exponent < 0; ++exponent) {
+        result /= Rational(2);
+    }
+    return result;
+}
+
+bool encloses(const Interval& x, const Rational& exact) {
+    return exact_rational(x.lo) <= exact && exact <= exact_rational(x.hi);
+}
+
+int sign_of(const Rational& x) {
+    return x < Rational(0) ? -1 : (Rational(0) < x ? 1 : 0);
+}
+
+void intervalTest() {
+    std::cout << "Interval tests: \n";
+    std::mt19937 rnd(35);
+    assert(exact_rational(-0.375) == Rational(-3) / Rational(8));
+    assert(exact_rational(3 + std::ldexp(1.0, -40)) * Rational(1 << 20) * Rational(1 << 20)
+           == Rational(3) * Rational(1 << 20) * Rational(1 << 20) + Rational(1));
+
+    for (int t = 0; t < 200; ++t) {
+        double x = static_cast<double>(static_cast<int>(rnd() % 2001) - 1000) / 7;
+        double y = static_cast<double>(static_cast<int>(rnd() % 2001) - 1000) / 13;
+        if (y == 0)
+            continue;
+        Rational ex = exact_rational(x);
+        Rational ey = exact_rational(y);
+        assert(encloses(Interval(x) + Interval(y), ex + ey));
+        assert(encloses(Interval(x) - Interval(y), ex - ey));
+        assert(encloses(Interval(x) * Interval(y), ex * ey));
+        assert(encloses(Interval(x) / Interval(y), ex / ey));
+    }
+    assert(Interval(3) * Interval(5) == Interval(15));
+    std::cout << "Ok! Interval operations enclose the exact results, exact ones stay points\n";
+
+    for (int t = 0; t < 10; ++t) {
+        Matrix<4, 4, Interval> a;
+        Matrix<4, 4, Rational> exact;
+        for (unsigned i = 0; i < 4; ++i) {
+            for (unsigned j = 0; j < 4; ++j) {
+                double x = static_cast<double>(static_cast<int>(rnd() % 201) - 100) / 3;
+                a[i][j] = Interval(x);
+                exact[i][j] = exact_rational(x);
+            }
+        }
+        assert(encloses(LU<4, Interval>(a).det(), laplace_det(table_of(exact))));
+    }
+    std::cout << "Ok! Interval elimination encloses the exact det\n";
+
+    unsigned fallbacks = 0;
+    for (int t = 0; t < 30; ++t) {
+        // dyadic entries, exact in double and in Rational
+        Matrix<5, 5, double> a;
+        Matrix<5, 5, Rational> exact;
+        for (unsigned i = 0; i < 5; ++i) {
+            for (unsigned j = 0; j < 5; ++j) {
+                int k = static_cast<int>(rnd() % 101) - 50;
+                a[i][j] = k / 1024.0;
+                exact[i][j] = Rational(k) / Rational(1024);
+            }
+        }
+        if (t % 3 != 0) {
+            // a dependent row
+            for (unsigned j = 0; j < 5; ++j) {
+                a[4][j] = a[0][j] + a[1][j];
+                exact[4][j] = exact[0][j] + exact[1][j];
+            }
+        }
+        if (t % 3 == 2) {
+            // and a perturbation of 2^-40, far below what elimination in double can see
+            a[4][2] += std::ldexp(1.0, -40);
+            exact[4][2] += Rational(1) / (Rational(1 << 20) * Rational(1 << 20));
+            ++fallbacks;
+        }
+        assert(adaptive_rank(a) == exact.rank());
+        assert(adaptive_rank(DynamicMatrix<double>(a)) == exact.rank());
+        assert(adaptive_det_sign(a) == sign_of(laplace_det(table_of(exact))));
+        assert(adaptive_det_sign(DynamicMatrix<double>(a)) == adaptive_det_sign(a));
+    }
+    assert(fallbacks > 0);
+    std::cout << "Ok! Certified rank and det sign match exact rational elimination\n";
+}
+
+// p(A) by Horner's rule, coefficients of p from x^0 up
+template <typename Field>
+std::vector<std::vector<Field>> evaluate_at_matrix(const polynom<Field>& p, const std::vector<std::vector<Field>>& a) {
+    std::vector<std::vector<Field>> result(a.size(), std::vector<Field>(a.size()));
+    for (size_t k = p.size(); k-- > 0;) {
+        result = naive_multiply(result, a);
+        for (size_t i = 0; i < a.size(); ++i) {
+            result[i][i] += p[k];
+        }
+    }
+    return result;
+}
+
+template <typename Field>
+Field evaluate(const polynom<Field>& p, const Field& x) {
+    Field result(0);
+    for (size_t k = p.size(); k-- > 0;) {
+        result = result * x + p[k];
+    }
+    return result;
+}
+
+// det(xI - A) at x = 0..n by the Laplace expansion, the definition of the charpoly
+template <unsigned N, typename Field>
+bool matches_characteristic_det(const Matrix<N, N, Field>& a, const polynom<Field>& p) {
+    if (p.size() != N + 1 || p[N] != Field(1))
+        return false;
+    for (int x = 0; x <= static_cast<int>(N); ++x) {
+        std::vector<std::vector<Field>> shifted = table_of(a);
+        for (unsigned i = 0; i < N; ++i) {
+            for (unsigned j = 0; j < N; ++j) {
+                shifted[i][j] = (i == j ? Field(x) : Field(0)) - shifted[i][j];
+            }
+        }
+        if (laplace_det(shifted) != evaluate(p, Field(x)))
+            return false;
+    }
+    return true;
+}
+
+template <typename Field>
+bool is_zero_table(const std::vector<std::vector<Field>>& a) {
+    for (auto& row : a) {
+        for (auto& x : row) {
+            if (x != Field(0))
+                return false;
+        }
+    }
+    return true;
+}
+
+void charpolyTest() {
+    std::cout << "Charpoly tests: \n";
+    std::mt19937 rnd(36);
+
+    for (int t = 0; t < 5; ++t) {
+        Matrix<6, 6, Residue<10007>> a = random_matrix<6, 6, Residue<10007>>(rnd);
+        Matrix<5, 5, Rational> b = random_matrix<5, 5, Rational>(rnd, 30);
+        Matrix<5, 5, BigInteger> c = random_matrix<5, 5, BigInteger>(rnd, 30);
+        assert(matches_characteristic_det(a, a.charpoly()));
+        assert(matches_characteristic_det(b, b.charpoly()));
+        assert(matches_characteristic_det(c, c.charpoly()));
+        assert(DynamicMatrix<Rational>(b).charpoly() == b.charpoly());
+        // Cayley-Hamilton
+        assert(is_zero_table(evaluate_at_matrix(a.charpoly(), table_of(a))));
+        assert(is_zero_table(evaluate_at_matrix(b.charpoly(), table_of(b))));
+    }
+    std::cout << "Ok! charpoly is det(xI - A) and annihilates A for residues, Rational and BigInteger\n";
+
+    // diag(2, 2, 3): (x - 2)(x - 3); a Jordan block J_2(2) next to 2: (x - 2)^2
+    Matrix<3, 3, Rational> diagonal = {{2, 0, 0}, {0, 2, 0}, {0, 0, 3}};
+    Matrix<3, 3, Rational> jordan = {{2, 1, 0}, {0, 2, 0}, {0, 0, 2}};
+    Matrix<3, 3, Rational> scalar = {{5, 0, 0}, {0, 5, 0}, {0, 0, 5}};
+    assert(diagonal.minpoly() == polynom<Rational>({Rational(6), Rational(-5), Rational(1)}));
+    assert(jordan.minpoly() == polynom<Rational>({Rational(4), Rational(-4), Rational(1)}));
+    assert(scalar.minpoly() == polynom<Rational>({Rational(-5), Rational(1)}));
+    for (int t = 0; t < 5; ++t) {
+        // a repeated block keeps the minpoly strictly below the charpoly
+        Matrix<3, 3, Residue<10007>> block = random_matrix<3, 3, Residue<10007>>(rnd);
+        Matrix<6, 6, Residue<10007>> a;
+        for (unsigned i = 0; i < 3; ++i) {
+            for (unsigned j = 0; j < 3; ++j) {
+                a[i][j] = a[i + 3][j + 3] = block[i][j];
+            }
+        }
+        polynom<Residue<10007>> m = a.minpoly();
+        assert(m == block.minpoly());
+        assert(m.size() < a.charpoly().size());
+        assert(m.back() == Residue<10007>(1));
+        assert(is_zero_table(evaluate_at_matrix(m, table_of(a))));
+    }
+    std::cout << "Ok! minpoly is the monic annihilator of least degree\n";
+
+    // U D U^-1 with U unit upper triangular: exact in double, eigenvalues 1..6
+    Matrix<6, 6, double> u;
+    Matrix<6, 6, double> d;
+    for (unsigned i = 0; i < 6; ++i) {
+        d[i][i] = i + 1;
+        u[i][i] = 1;
+        for (unsigned j = i + 1; j < 6; ++j) {
+            u[i][j] = static_cast<int>(rnd() % 5) - 2;
+        }
+    }
+    Matrix<6, 6, double> a = u * d * u.inverted();
+    std::vector<complex> lambda = eigenvalues(a);
+    assert(lambda.size() == 6);
+    std::sort(lambda.begin(), lambda.end(), [](complex x, complex y) { return x.real() < y.real(); });
+    for (unsigned i = 0; i < 6; ++i) {
+        assert(std::abs(lambda[i] - complex(i + 1, 0)) < 1e-6);
+    }
+    // entries far below 1e-7 are still reduced, not skipped: L U D (L U)^-1 is dense
+    Matrix<6, 6, double> l;
+    for (unsigned i = 0; i < 6; ++i) {
+        l[i][i] = 1;
+        for (unsigned j = 0; j < i; ++j) {
+            l[i][j] = static_cast<int>(rnd() % 3) - 1;
+        }
+    }
+    Matrix<6, 6, double> tiny = l * a * l.inverted() * 1e-9;
+    std::vector<complex> tiny_lambda = eigenvalues(tiny);
+    assert(tiny_lambda.size() == 6);
+    std::sort(tiny_lambda.begin(), tiny_lambda.end(), [](complex x, complex y) { return x.real() < y.real(); });
+    for (unsigned i = 0; i < 6; ++i) {
+        assert(std::abs(tiny_lambda[i] - complex(1e-9 * (i + 1), 0)) < 1e-15);
+    }
+    // a rotation: +-i
+    Matrix<2, 2, double> rotation = {{0, -1}, {1, 0}};
+    std::vector<complex> rotation_lambda = eigenvalues(rotation);
+    assert(std::abs(rotation_lambda[0].imag()) > 0.999 && std::abs(rotation_lambda[0] + rotation_lambda[1]) < 1e-9);
+    std::cout << "Ok! QR eigenvalues recover a known spectrum\n";
+}
+
+void fileTest() {
+    std::cout << "File tests: \n";
+    std::mt19937 rnd(37);
+    const std::string path = "matrix_test_file.bin";
+
+    Matrix<7, 5, double> a = random_matrix<7, 5, double>(rnd);
+    a[0][0] = 0.1;
+    a[6][4] = -1e300;
+    Matrix<7, 5, double> loaded_a;
+    assert(save_matrix(path, a));
+    assert(load_matrix(path, loaded_a));
+    assert(loaded_a == a);
+    {
+        MappedMatrix<double> mapped(path);
+        assert(mapped.good() && mapped.rows() == 7 && mapped.cols() == 5);
+        assert(table_of(mapped.toDynamic()) == table_of(a));
+        assert(mapped.at(6, 4) == -1e300);
+    }
+    // a file of another field or another shape is refused
+    Matrix<5, 7, double> wrong_shape;
+    DynamicMatrix<Residue<7>> wrong_field(1, 1);
+    assert(!load_matrix(path, wrong_shape));
+    assert(!load_matrix(path, wrong_field));
+    assert(!MappedMatrix<float>(path).good());
+
+    DynamicMatrix<Residue<998244353>> b(random_matrix<9, 4, Residue<998244353>>(rnd));
+    DynamicMatrix<Residue<998244353>> loaded_b(1, 1);
+    assert(save_matrix(path, b));
+    assert(load_matrix(path, loaded_b));
+    assert(table_of(loaded_b) == table_of(b));
+    std::cout << "Ok! Trivially copyable fields round-trip through files and mappings\n";
+
+    // multi-limb integers and negative fractions are stored limb by limb
+    Matrix<3, 3, Rational> c = random_matrix<3, 3, Rational>(rnd);
+    BigInteger big(1);
+    for (int i = 0; i < 12; ++i) {
+        big *= BigInteger(1000003);
+    }
+    c[1][1] = Rational(big) / Rational(-7);
+    c[2][0] = -Rational(big) * Rational(big);
+    Matrix<3, 3, Rational> loaded_c;
+    assert(save_matrix(path, c));
+    assert(load_matrix(path, loaded_c));
+    assert(loaded_c == c);
+
+    Matrix<2, 2, BigInteger> d = {{1, -2}, {3, 4}};
+    d[0][1] = -big;
+    Matrix<2, 2, BigInteger> loaded_d;
+    assert(save_matrix(path, d));
+    assert(load_matrix(path, loaded_d));
+    assert(loaded_d == d);
+    std::cout << "Ok! Rational and BigInteger round-trip exactly\n";
+
+    // streaming: a writer that is closed early reports it
+    MatrixWriter<double> partial(path, 3, 2);
+    partial.writeRow({1, 2});
+    assert(!partial.close());
+    MatrixReader<double> reader(path);
+    std::vector<double> row;
+    assert(reader.good() && reader.readRow(row) && row == std::vector<double>({1, 2}));
+    assert(!reader.readRow(row));
+    std::cout << "Ok! Short files are reported by the writer and the reader\n";
+
+    // shapes beyond the unsigned accessors, or whose size wraps around 2^64, are refused
+    // before the length of the file is compared with them
+    const uint64_t shapes[][3] = {{1ull << 32, 1, 0}, {1ull << 31, 1ull << 30, 0}, {1ull << 31, 1ull << 31, 1}};
+    for (const auto& shape : shapes) {
+        MatrixFileHeader header = matrix_file_header<double>(0, 0);
+        header.rows = shape[0];
+        header.cols = shape[1];
+        header.tile = shape[2];
+        std::ofstream out(path, std::ios::binary);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(std::string(64, '\0').data(), 64);
+        out.close();
+        if (header.tile == 0) {
+            assert(!MatrixReader<double>(path).good());
+            assert(!MappedMatrix<double>(path).good());
+        } else {
+            assert(!TiledMatrix<double>(path).good());
+        }
+    }
+    std::remove(path.c_str());
+    std::cout << "Ok! Headers whose shape overflows are refused\n";
+}
+
+template <typename Field>
+void outOfCoreTest(const DynamicMatrix<Field>& a, const DynamicMatrix<Field>& b, unsigned tile, size_t budget_tiles) {
+    const std::string a_path = "matrix_test_a.bin";
+    const std::string b_path = "matrix_test_b.bin";
+    const std::string rows_path = "matrix_test_rows.bin";
+    const std::string c_path = "matrix_test_c.bin";
+    assert(save_matrix(rows_path, a));
+    assert(convert_to_tiled<Field>(rows_path, a_path, tile));
+    assert(save_matrix(rows_path, b));
+    assert(convert_to_tiled<Field>(rows_path, b_path, tile));
+    {
+        TiledMatrix<Field> ta(a_path);
+        TiledMatrix<Field> tb(b_path);
+        TiledMatrix<Field> tc(c_path, a.rows(), b.cols(), tile);
+        assert(ta.good() && tb.good() && tc.good());
+        assert(table_of(ta.toDynamic()) == table_of(a));
+        OutOfCoreStats stats = out_of_core_multiply(ta, tb, tc, budget_tiles * ta.tileBytes());
+        assert(stats.ok);
+        assert(stats.bytes_read > 0 && stats.bytes_written > 0);
+        assert(table_of(tc.toDynamic()) == naive_multiply(table_of(a), table_of(b)));
+    }
+    for (const std::string& path : {a_path, b_path, rows_path, c_path}) {
+        std::remove(path.c_str());
+    }
+}
+
+void tiledMultiplyTest() {
+    std::cout << "Out-of-core multiply tests: \n";
+    std::mt19937 rnd(38);
+
+    // sides that are not multiples of the tile, so the edge tiles carry padding
+    DynamicMatrix<Residue<998244353>> a(random_matrix<50, 37, Residue<998244353>>(rnd));
+    DynamicMatrix<Residue<998244353>> b(random_matrix<37, 45, Residue<998244353>>(rnd));
+    outOfCoreTest(a, b, 8, 6);
+    outOfCoreTest(a, b, 8, 100);
+    outOfCoreTest(a, b, 64, 6);
+
+    DynamicMatrix<double> c(random_matrix<33, 20, double>(rnd, 50));
+    DynamicMatrix<double> d(random_matrix<20, 17, double>(rnd, 50));
+    outOfCoreTest(c, d, 5, 12);
+    std::cout << "Ok! Tiled products match the in-memory definition for every memory budget\n";
+}
+
+void solveTest() {
+    std::cout << "Solve tests: \n";
+    std::mt19937 rnd(40);
+
+    // integer systems take Dixon lifting
+    for (int t = 0; t < 5; ++t) {
+        Matrix<12, 12, Rational> a = random_matrix<12, 12, Rational>(rnd);
+        Matrix<12, 3, Rational> b = random_matrix<12, 3, Rational>(rnd, 1000000);
+        if (a.det() == Rational(0))
+            continue;
+        Matrix<12, 3, Rational> x = a.solve(b);
+        assert(table_of(a * x) == table_of(b));
+        assert(x == LU<12>(a).solve(b));
+    }
+
+    // fractions: rows are scaled to integers first
+    Matrix<4, 4, Rational> fractions = random_matrix<4, 4, Rational>(rnd, 50);
+    for (unsigned i = 0; i < 4; ++i) {
+        fractions[i][i] = Rational(200 + i) / Rational(3 + i);
+        fractions[i][(i + 1) % 4] /= Rational(7);
+    }
+    Matrix<4, 1, Rational> rhs = {{1}, {-2}, {3}, {-4}};
+    rhs[2][0] /= Rational(11);
+    assert(table_of(fractions * fractions.solve(rhs)) == table_of(rhs));
+
+    // entries above 2^31 fall back to Rational Gauss
+    Matrix<3, 3, Rational> large = {{0, 2, 1}, {1, 1, 1}, {2, 0, 5}};
+    large[0][1] = Rational(BigInteger(1LL << 40));
+    Matrix<3, 2, Rational> large_rhs = {{1, 0}, {0, 1}, {7, -3}};
+    assert(table_of(large * large.solve(large_rhs)) == table_of(large_rhs));
+    std::cout << "Ok! Rational solve satisfies A X = B on the Dixon and the Gauss paths\n";
+
+    Matrix<70, 70, Residue<10007>> r = random_matrix<70, 70, Residue<10007>>(rnd);
+    Matrix<70, 2, Residue<10007>> r_rhs = random_matrix<70, 2, Residue<10007>>(rnd);
+    if (r.det() != Residue<10007>(0))
+        assert(table_of(r * r.solve(r_rhs)) == table_of(r_rhs));
+
+    Matrix<3, 3, double> d = {{0, 2, 1}, {1, 1, 1}, {2, 0, 5}};
+    Matrix<3, 1, double> d_rhs = {{3}, {3}, {7}};
+    Matrix<3, 1, double> d_x = d.solve(d_rhs);
+    for (unsigned i = 0; i < 3; ++i) {
+        assert(std::abs(d_x[i][0] - 1) < 1e-12);
+    }
+    std::cout << "Ok! Residue and double solve satisfy A X = B\n";
+}
+
+// a non-negative BigInteger below 2^64
+uint64_t to_uint64(const BigInteger& x) {
+    uint64_t result = 0;
+    for (size_t l = x.size(); l-- > 0;) {
+        result = result * BigInteger::radix + x[l];
+    }
+    return result;
+}
+
+void crtTest() {
+    std::cout << "CRT tests: \n";
+    std::mt19937_64 rnd(47);
+
+    // every x below 3 * 5 * 7 * 8 from its residues
+    for (int x = 0; x < 840; ++x) {
+        assert(crt(Residue<3>(x), Residue<5>(x), Residue<7>(x), Residue<8>(x)) == BigInteger(x));
+    }
+    assert(crt(Residue<11>(4)) == BigInteger(4));
+    std::cout << "Ok! crt inverts reduction for small moduli\n";
+
+    const uint64_t Q = (1ULL << 61) - 1;
+    for (int t = 0; t < 100; ++t) {
+        BigInteger x = BigInteger(static_cast<long long>(rnd() >> 4)) * BigInteger(static_cast<long long>(rnd() >> 4))
+                       + BigInteger(static_cast<long long>(rnd() >> 4));
+        Residue<998244353> a(static_cast<int>(to_uint64(x % BigInteger(998244353))));
+        Residue<1000000007> b(static_cast<int>(to_uint64(x % BigInteger(1000000007))));
+        Residue64<Q> c(static_cast<long long>(to_uint64(x % big_integer_of(Q))));
+        assert(crt(a, b, c) == x);
+    }
+    std::cout << "Ok! crt recovers 120-bit integers from Residue and Residue64 parts\n";
+}
+
+void testingFunction() {
+    multiplyTest();
+    luTest();
+    expressionTest();
+    dynamicMatrixTest();
+    sparseTest();
+    gaussTest();
+    powerTest();
+    residueMultiplyTest();
+    transposeTest();
+    smallMatrixTests();
+    intervalTest();
+    charpolyTest();
+    fileTest();
+    tiledMultiplyTest();
+    solveTest();
+    crtTest();
+}
+
+#endif //MATRIX_H__TEST_MATRIX_H_
@@ -0,0 +1,232 @@
+// Benchmark harness for residue.h.
+//
+//   residue_benchmark [--ops multiply,naive,crt,inverse,divide,log,exp,fermat,gcd,add,subtract,construct]
+//                     [--logs 10,14,18,23] [--repeat 3] [--format csv|json] [--output file]
+//
+// Every run reports the best time over the repeats for polynomials of degree 2^log - 1
+// (the product has degree 2^(log + 1) - 2, so log 22 is the largest transform of length
+// 2^23 that 998244353 supports). multiply and the Newton operations run over
+// Residue<998244353>, crt multiplies over Residue<1000000007> through three NTT primes,
+// and naive is the quadratic product the library replaces. fermat and gcd invert 2^log
+// single elements of Residue<998244353>, by x^(P - 2) and by getInverse. add, subtract
+// and construct fold 2^log elements into one running sum (2^27 is above 10^8); they cycle
+// through 2^16 inputs so that the loop measures the arithmetic rather than memory.
+#include "residue.h"
+
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <random>
+#include <sstream>
+#include <string>
+
+const unsigned ntt_prime = 998244353;
+const unsigned crt_prime = 1000000007;
+
+// the sums are stored here so that they are not optimized away
+volatile unsigned sink = 0;
+
+struct Record {
+    std::string op;
+    unsigned modulus = 0;
+    unsigned log = 0;
+    double seconds = 0;
+    // nanoseconds per coefficient of the input
+    double ns_per_coefficient = 0;
+};
+
+struct Options {
+    std::vector<std::string> ops = {"multiply", "naive", "crt", "inverse", "divide", "log", "exp", "fermat", "gcd",
+                                    "add", "subtract", "construct"};
+    std::vector<unsigned> logs;
+    unsigned repeat = 3;
+    std::string format = "csv";
+    std::string output;
+};
+
+std::vector<std::string> split(const std::string& list) {
+    std::vector<std::string> result;
+    std::stringstream in(list);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        if (!item.empty())
+            result.push_back(item);
+    }
+    return result;
+}
+
+double seconds_of(const std::function<void()>& run) {
+    auto start = std::chrono::steady_clock::now();
+    run();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+double best_of(unsigned repeat, const std::function<void()>& run) {
+    double best = INFINITY;
+    for (unsigned r = 0; r < repeat; ++r) {
+        best = std::min(best, seconds_of(run));
+    }
+    return best;
+}
+
+template<unsigned P>
+Polynomial<Residue<P>> random_polynomial(size_t n, std::mt19937& generator) {
+    std::vector<Residue<P>> c(n);
+    for (Residue<P>& x : c) {
+        x = Residue<P>(static_cast<int>(generator() % P));
+    }
+    c[0] = Residue<P>(1);
+    c[n - 1] = Residue<P>(1);
+    return Polynomial<Residue<P>>(c);
+}
+
+// the default sizes keep the quadratic product below a few seconds
+std::vector<unsigned> default_logs(const std::string& op) {
+    if (op == "naive")
+        return {8, 10, 12, 14};
+    if (op == "log" || op == "exp")
+        return {10, 14, 18, 20};
+    if (op == "fermat" || op == "gcd")
+        return {16, 20};
+    if (op == "add" || op == "subtract" || op == "construct")
+        return {20, 27};
+    return {10, 14, 18, 20, 22};
+}
+
+void write_csv(std::ostream& out, const std::vector<Record>& records) {
+    out << "op,modulus,log,seconds,ns_per_coefficient\n";
+    for (const Record& r : records) {
+        out << r.op << "," << r.modulus << "," << r.log << "," << r.seconds << "," << r.ns_per_coefficient << "\n";
+    }
+}
+
+void write_json(std::ostream& out, const std::vector<Record>& records) {
+    out << "[\n";
+    for (size_t i = 0; i < records.size(); ++i) {
+        const Record& r = records[i];
+        out << "  {\"op\": \"" << r.op << "\", \"modulus\": " << r.modulus << ", \"log\": " << r.log
+            << ", \"seconds\": " << r.seconds << ", \"ns_per_coefficient\": " << r.ns_per_coefficient << "}"
+            << (i + 1 < records.size() ? "," : "") << "\n";
+    }
+    out << "]\n";
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--ops" && has_value) {
+            options.ops = split(argv[++i]);
+        } else if (arg == "--logs" && has_value) {
+            for (const std::string& log : split(argv[++i])) {
+                options.logs.push_back(std::stoul(log));
+            }
+        } else if (arg == "--repeat" && has_value) {
+            options.repeat = std::max(1ul, std::stoul(argv[++i]));
+        } else if (arg == "--format" && has_value) {
+            options.format = argv[++i];
+        } else if (arg == "--output" && has_value) {
+            options.output = argv[++i];
+        } else {
+            std::cerr << "unknown argument " << arg << "\n";
+            return 1;
+        }
+    }
+
+    std::vector<Record> records;
+    std::mt19937 generator(1);
+    for (const std::string& op : options.ops) {
+        std::vector<unsigned> logs = options.logs.empty() ? default_logs(op) : options.logs;
+        for (unsigned log : logs) {
+            size_t n = size_t(1) << log;
+            Record record;
+            record.op = op;
+            record.modulus = op == "crt" ? crt_prime : ntt_prime;
+            record.log = log;
+            if (op == "add" || op == "subtract" || op == "construct") {
+                const size_t mask = (size_t(1) << 16) - 1;
+                std::vector<Residue<ntt_prime>> x(mask + 1);
+                // small inputs in (-P, P), the range the constructor takes without a division
+                std::vector<int> values(mask + 1);
+                for (size_t i = 0; i <= mask; ++i) {
+                    values[i] = static_cast<int>(generator() % (2 * ntt_prime - 1)) - static_cast<int>(ntt_prime - 1);
+                    x[i] = Residue<ntt_prime>(values[i]);
+                }
+                record.seconds = best_of(options.repeat, [&]() {
+                    Residue<ntt_prime> sum;
+                    if (op == "add") {
+                        for (size_t i = 0; i < n; ++i) {
+                            sum += x[i & mask];
+                        }
+                    } else if (op == "subtract") {
+                        for (size_t i = 0; i < n; ++i) {
+                            sum -= x[i & mask];
+                        }
+                    } else {
+                        for (size_t i = 0; i < n; ++i) {
+                            sum += Residue<ntt_prime>(values[i & mask]);
+                        }
+                    }
+                    sink = static_cast<int>(sum);
+                });
+            } else if (op == "fermat" || op == "gcd") {
+                std::vector<Residue<ntt_prime>> x(n);
+                for (Residue<ntt_prime>& y : x) {
+                    y = Residue<ntt_prime>(static_cast<int>(generator() % (ntt_prime - 1) + 1));
+                }
+                std::vector<Residue<ntt_prime>> inverses(n);
+                bool fermat = op == "fermat";
+                record.seconds = best_of(options.repeat, [&]() {
+                    for (size_t i = 0; i < n; ++i) {
+                        inverses[i] = fermat ? x[i].pow(ntt_prime - 2) : x[i].getInverse();
+                    }
+                });
+            } else if (op == "crt") {
+                Polynomial<Residue<crt_prime>> a = random_polynomial<crt_prime>(n, generator);
+                Polynomial<Residue<crt_prime>> b = random_polynomial<crt_prime>(n, generator);
+                record.seconds = best_of(options.repeat, [&]() { a * b; });
+            } else {
+                Polynomial<Residue<ntt_prime>> a = random_polynomial<ntt_prime>(n, generator);
+                Polynomial<Residue<ntt_prime>> b = random_polynomial<ntt_prime>(n, generator);
+                Polynomial<Residue<ntt_prime>> c = a * b;
+                if (op == "multiply") {
+                    record.seconds = best_of(options.repeat, [&]() { a * b; });
+                } else if (op == "naive") {
+                    std::vector<Residue<ntt_prime>> product(2 * n - 1);
+                    record.seconds = best_of(options.repeat, [&]() {
+                        for (size_t i = 0; i < n; ++i) {
+                            for (size_t j = 0; j < n; ++j) {
+                                product[i + j] += a[i] * b[j];
+                            }
+                        }
+                    });
+                } else if (op == "inverse") {
+                    record.seconds = best_of(options.repeat, [&]() { a.inverse(n); });
+                } else if (op == "divide") {
+                    record.seconds = best_of(options.repeat, [&]() { c / b; });
+                } else if (op == "log") {
+                    record.seconds = best_of(options.repeat, [&]() { a.log(n); });
+                } else if (op == "exp") {
+                    Polynomial<Residue<ntt_prime>> f = a - Polynomial<Residue<ntt_prime>>{1};
+                    record.seconds = best_of(options.repeat, [&]() { f.exp(n); });
+                } else {
+                    std::cerr << "unknown op " << op << "\n";
+                    return 1;
+                }
+            }
+            record.ns_per_coefficient = record.seconds / n * 1e9;
+            records.push_back(record);
+        }
+    }
+
+    std::ofstream file;
+    if (!options.output.empty())
+        file.open(options.output);
+    std::ostream& out = options.output.empty() ? std::cout : file;
+    if (options.format == "json")
+        write_json(out, records);
+    else
+        write_csv(out, records);
+    return 0;
+}
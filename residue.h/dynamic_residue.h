@@ -0,0 +1,278 @@
+// Shared by residue.h and matrix.h: residues modulo a number chosen at runtime.
+#ifndef RESIDUE_H_DYNAMIC_RESIDUE_H_
+#define RESIDUE_H_DYNAMIC_RESIDUE_H_
+
+#include "number_theory.h"
+
+#include <assert.h>
+#include <iostream>
+
+// Modulus chosen at runtime. A ModContext precomputes everything Residue<N> gets from N
+// at compile time; DynamicResidue reads the context made current on its thread by
+// ModContext::Scope, so an element is just its value and a hot loop pays one
+// thread-local load per operation. Odd moduli use Montgomery form x * 2^32 mod n,
+// even ones Barrett reduction with floor((2^64 - 1) / n); addition and subtraction
+// are the same in both.
+class ModContext {
+private:
+    uint32_t modulus_;
+    bool montgomery_;
+    uint32_t inverse_ = 0;
+    uint32_t r2_ = 0;
+    uint32_t r3_ = 0;
+    uint64_t barrett_ = 0;
+    unsigned EF;
+    prime_factorization EF_factors;
+    bool prime;
+    unsigned root;
+    static inline thread_local const ModContext* active = nullptr;
+public:
+    explicit ModContext(unsigned modulus): modulus_(modulus), montgomery_(modulus % 2 == 1),
+            EF(euler_function(modulus)), EF_factors(factorize(EF)), prime(is_prime_number(modulus)),
+            root(primitive_root(modulus)) {
+        // sums of two residues must fit in 32 bits
+        assert(modulus >= 1 && modulus < (1u << 31));
+        if (montgomery_) {
+            // Newton iteration doubles the number of correct low bits of n^-1 mod 2^32
+            inverse_ = modulus;
+            for (int i = 0; i < 4; ++i) {
+                inverse_ *= 2 - modulus * inverse_;
+            }
+            r2_ = ((1ULL << 32) % modulus) * ((1ULL << 32) % modulus) % modulus;
+            r3_ = multiply(r2_, r2_);
+        } else {
+            barrett_ = ~0ULL / modulus;
+        }
+    }
+
+    uint32_t modulus() const {
+        return modulus_;
+    }
+
+    unsigned totient() const {
+        return EF;
+    }
+
+    const prime_factorization& totientFactors() const {
+        return EF_factors;
+    }
+
+    bool isPrime() const {
+        return prime;
+    }
+
+    // 0 when the modulus has no primitive root
+    unsigned primitiveRoot() const {
+        return root;
+    }
+
+    uint32_t multiply(uint32_t x, uint32_t y) const {
+        uint64_t t = static_cast<uint64_t>(x) * y;
+        if (montgomery_) {
+            // m * n has the same low half as t, so only the high halves are subtracted
+            uint32_t m = static_cast<uint32_t>(t) * inverse_;
+            uint32_t u = static_cast<uint32_t>(t >> 32) - static_cast<uint32_t>((static_cast<uint64_t>(m) * modulus_) >> 32);
+            return static_cast<int32_t>(u) < 0 ? u + modulus_ : u;
+        }
+        uint64_t q = (static_cast<unsigned __int128>(t) * barrett_) >> 64;
+        uint64_t r = t - q * modulus_;
+        return r >= modulus_ ? r - modulus_ : r;
+    }
+
+    // x < modulus into the representation used by multiply and back
+    uint32_t toForm(uint32_t x) const {
+        return montgomery_ ? multiply(x, r2_) : x;
+    }
+
+    uint32_t fromForm(uint32_t x) const {
+        return montgomery_ ? multiply(x, 1) : x;
+    }
+
+    // The form of x^-1 from the form of x, 0 when x is not invertible. The Euclidean inverse
+    // of a Montgomery form x R is x^-1 R^-1, and one multiplication by R^3 turns it into x^-1 R.
+    uint32_t inverseForm(uint32_t x) const {
+        uint32_t y = inverse_mod(x, modulus_);
+        return montgomery_ ? multiply(y, r3_) : y;
+    }
+
+    static const ModContext& current() {
+        return *active;
+    }
+
+    static bool hasCurrent() {
+        return active != nullptr;
+    }
+
+    // Makes a context current on this thread for its lifetime, then restores the previous one.
+    class Scope {
+    private:
+        const ModContext* previous;
+    public:
+        explicit Scope(const ModContext& context): previous(active) {
+            active = &context;
+        }
+        ~Scope() {
+            active = previous;
+        }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+};
+
+class DynamicResidue {
+private:
+    unsigned int number = 0;
+public:
+    explicit DynamicResidue(int x) {
+        assert(ModContext::hasCurrent());
+        const ModContext& context = ModContext::current();
+        long long value = x % static_cast<long long>(context.modulus());
+        if (value < 0)
+            value += context.modulus();
+        number = context.toForm(value);
+    }
+
+    DynamicResidue(): number(0) {}
+
+    explicit operator int() const {
+        int x = ModContext::current().fromForm(number);
+        return x;
+    }
+
+    DynamicResidue& operator=(int x) {
+        return *this = DynamicResidue(x);
+    }
+
+    DynamicResidue& operator=(const DynamicResidue& x) = default;
+
+    DynamicResidue& operator+=(const DynamicResidue& x) {
+        number += x.number;
+        if (number >= ModContext::current().modulus())
+            number -= ModContext::current().modulus();
+        return *this;
+    }
+
+    DynamicResidue operator+(const DynamicResidue& x) const {
+        DynamicResidue a = *this;
+        a += x;
+        return a;
+    }
+
+    DynamicResidue operator-() const {
+        DynamicResidue a;
+        a -= *this;
+        return a;
+    }
+
+    DynamicResidue& operator-=(const DynamicResidue& x) {
+        if (number < x.number)
+            number += ModContext::current().modulus();
+        number -= x.number;
+        return *this;
+    }
+
+    DynamicResidue operator-(const DynamicResidue& x) const {
+        DynamicResidue a = *this;
+        a -= x;
+        return a;
+    }
+
+    DynamicResidue& operator*=(const DynamicResidue& x) {
+        number = ModContext::current().multiply(number, x.number);
+        return *this;
+    }
+
+    DynamicResidue operator*(const DynamicResidue& x) const {
+        DynamicResidue a = *this;
+        a *= x;
+        return a;
+    }
+
+    bool operator==(const DynamicResidue& x) const {
+        return number == x.number;
+    }
+
+    bool operator!=(const DynamicResidue& x) const {
+        return number != x.number;
+    }
+
+    DynamicResidue pow(unsigned k) const {
+        DynamicResidue result(1);
+        DynamicResidue base = *this;
+        for (; k > 0; k >>= 1) {
+            if (k & 1)
+                result *= base;
+            base *= base;
+        }
+        return result;
+    }
+
+    bool isInvertible() const {
+        return gcd(number, ModContext::current().modulus()) == 1;
+    }
+
+    // Any modulus; asserts that the element is invertible.
+    DynamicResidue getInverse() const {
+        const ModContext& context = ModContext::current();
+        DynamicResidue result;
+        result.number = context.inverseForm(number);
+        assert(context.modulus() == 1 || result.number != 0);
+        return result;
+    }
+
+    DynamicResidue& operator/=(const DynamicResidue& x) {
+        DynamicResidue inv_x = x.getInverse();
+        return *this *= inv_x;
+    }
+
+    DynamicResidue operator/(const DynamicResidue& x) const {
+        DynamicResidue a = *this;
+        a /= x;
+        return a;
+    }
+
+    unsigned int order() const {
+        const ModContext& context = ModContext::current();
+        int value = static_cast<int>(*this);
+        if (value == 0 || context.totient() == 0)
+            return 0;
+        if (gcd(value, context.modulus()) != 1)
+            return 0;
+        if (value == 1)
+            return 1;
+
+        const prime_factorization& f = context.totientFactors();
+        unsigned int ans = context.totient();
+        for (unsigned i = 0; i < f.count; ++i) {
+            for (unsigned k = 0; k < f.powers[i]; ++k) {
+                if (static_cast<int>(pow(ans / f.primes[i])) != 1)
+                    break;
+                ans /= f.primes[i];
+            }
+        }
+        assert(static_cast<int>(pow(ans)) == 1);
+        return ans;
+    }
+
+    static DynamicResidue getPrimitiveRoot() {
+        assert(ModContext::current().primitiveRoot() != 0);
+        return DynamicResidue(ModContext::current().primitiveRoot());
+    }
+};
+
+inline bool operator==(const DynamicResidue& a, int b) {
+    return a == DynamicResidue(b);
+}
+
+inline bool operator!=(const DynamicResidue& a, int b) {
+    return a != DynamicResidue(b);
+}
+
+inline std::istream& operator>>(std::istream& in, DynamicResidue& i) {
+    int a;
+    in >> a;
+    i = a;
+    return in;
+}
+
+#endif // RESIDUE_H_DYNAMIC_RESIDUE_H_
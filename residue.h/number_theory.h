@@ -0,0 +1,385 @@
+// Shared by residue.h and matrix.h: the compile-time check used by the residue types
+// and constexpr number theory on their 32- and 64-bit moduli.
+#ifndef RESIDUE_H_NUMBER_THEORY_H_
+#define RESIDUE_H_NUMBER_THEORY_H_
+
+#include <cstdint>
+#include <initializer_list>
+
+template<bool condition>
+struct compilation_error {
+    static int d[condition ? 1 : -1];
+    ~compilation_error() = default;
+};
+
+// Number theory on 32-bit moduli, all constexpr: Residue<N> gets its constants at compile
+// time, even for N near 2^32.
+
+constexpr uint32_t multiply_mod(uint32_t a, uint32_t b, uint32_t n) {
+    return static_cast<uint64_t>(a) * b % n;
+}
+
+constexpr uint32_t pow_mod(uint32_t a, uint32_t k, uint32_t n) {
+    uint32_t result = 1 % n;
+    for (a %= n; k > 0; k >>= 1) {
+        if (k & 1)
+            result = multiply_mod(result, a, n);
+        a = multiply_mod(a, a, n);
+    }
+    return result;
+}
+
+// Miller-Rabin with the bases 2, 7 and 61 is deterministic below 4759123141
+constexpr bool is_prime_number(unsigned n) {
+    if (n < 2)
+        return false;
+    for (unsigned p : {2u, 3u, 5u, 7u}) {
+        if (n % p == 0)
+            return n == p;
+    }
+    unsigned d = n - 1;
+    unsigned s = 0;
+    while (d % 2 == 0) {
+        d /= 2;
+        ++s;
+    }
+    for (unsigned a : {2u, 7u, 61u}) {
+        if (a % n == 0)
+            continue;
+        uint32_t x = pow_mod(a, d, n);
+        if (x == 1 || x == n - 1)
+            continue;
+        bool composite = true;
+        for (unsigned i = 1; i < s && composite; ++i) {
+            x = multiply_mod(x, x, n);
+            composite = x != n - 1;
+        }
+        if (composite)
+            return false;
+    }
+    return true;
+}
+
+// A 32-bit number has at most 9 distinct prime divisors.
+struct prime_factorization {
+    unsigned count = 0;
+    unsigned primes[9] = {};
+    unsigned powers[9] = {};
+};
+
+// Trial division, cut short as soon as the rest is prime.
+constexpr prime_factorization factorize(unsigned n) {
+    prime_factorization result;
+    bool prime_rest = is_prime_number(n);
+    for (unsigned i = 2; n > 1; ++i) {
+        if (prime_rest || 1ULL * i * i > n)
+            i = n;
+        if (n % i != 0)
+            continue;
+        result.primes[result.count] = i;
+        while (n % i == 0) {
+            n /= i;
+            ++result.powers[result.count];
+        }
+        ++result.count;
+        prime_rest = is_prime_number(n);
+    }
+    return result;
+}
+
+constexpr unsigned euler_function(unsigned N) {
+    if (N == 0) return 0;
+    prime_factorization f = factorize(N);
+    for (unsigned i = 0; i < f.count; ++i) {
+        N = N / f.primes[i] * (f.primes[i] - 1);
+    }
+    return N;
+}
+
+// on unsigned values: moduli and residues may exceed INT_MAX
+constexpr unsigned gcd(unsigned x, unsigned y) {
+    if (x == 0) return y;
+    return gcd(y % x, x);
+}
+
+// 2, 4, p^k and 2 p^k for an odd prime p
+constexpr bool has_primitive_root_number(unsigned n) {
+    if (n == 2 || n == 4)
+        return true;
+    if (n < 2 || n % 4 == 0)
+        return false;
+    return factorize(n % 2 == 0 ? n / 2 : n).count == 1;
+}
+
+// The smallest g whose order is EF: g^(EF / p) != 1 for every prime p dividing EF.
+// 0 when there is none.
+constexpr unsigned primitive_root(unsigned n) {
+    if (!has_primitive_root_number(n))
+        return 0;
+    unsigned EF = euler_function(n);
+    prime_factorization f = factorize(EF);
+    for (unsigned g = 1; g < n; ++g) {
+        if (gcd(g, n) != 1)
+            continue;
+        bool root = true;
+        for (unsigned i = 0; i < f.count && root; ++i) {
+            root = pow_mod(g, EF / f.primes[i], n) != 1;
+        }
+        if (root)
+            return g;
+    }
+    return 0;
+}
+
+// x with a x = 1 (mod m) by the extended Euclidean algorithm, 0 when gcd(a, m) != 1.
+constexpr uint32_t inverse_mod(uint32_t a, uint32_t m) {
+    int64_t r0 = m, r1 = a % m;
+    int64_t t0 = 0, t1 = 1;
+    while (r1 != 0) {
+        int64_t q = r0 / r1;
+        int64_t r = r0 - q * r1;
+        r0 = r1;
+        r1 = r;
+        int64_t t = t0 - q * t1;
+        t0 = t1;
+        t1 = t;
+    }
+    if (r0 != 1)
+        return 0;
+    return t0 < 0 ? t0 + m : t0;
+}
+
+// Tonelli-Shanks for an odd prime p: p - 1 = q 2^s with q odd, and root = z^q for the
+// smallest quadratic non-residue z generates the Sylow 2-subgroup.
+struct square_root_constants {
+    unsigned s = 0;
+    unsigned q = 0;
+    uint32_t root = 0;
+};
+
+constexpr square_root_constants tonelli_shanks_constants(unsigned p) {
+    square_root_constants result;
+    if (p < 3)
+        return result;
+    result.q = p - 1;
+    while (result.q % 2 == 0) {
+        result.q /= 2;
+        ++result.s;
+    }
+    unsigned z = 2;
+    while (pow_mod(z, (p - 1) / 2, p) != p - 1) {
+        ++z;
+    }
+    result.root = pow_mod(z, result.q, p);
+    return result;
+}
+
+// Number theory on 64-bit moduli for Residue64<N>, again constexpr: products go through
+// unsigned __int128 and factorization through Pollard's rho.
+
+constexpr uint64_t multiply_mod64(uint64_t a, uint64_t b, uint64_t n) {
+    return static_cast<unsigned __int128>(a) * b % n;
+}
+
+constexpr uint64_t pow_mod64(uint64_t a, uint64_t k, uint64_t n) {
+    uint64_t result = 1 % n;
+    for (a %= n; k > 0; k >>= 1) {
+        if (k & 1)
+            result = multiply_mod64(result, a, n);
+        a = multiply_mod64(a, a, n);
+    }
+    return result;
+}
+
+constexpr uint64_t gcd64(uint64_t x, uint64_t y) {
+    while (x != 0) {
+        uint64_t r = y % x;
+        y = x;
+        x = r;
+    }
+    return y;
+}
+
+// Miller-Rabin with the primes up to 37 as bases is deterministic for every 64-bit n
+constexpr bool is_prime_number64(uint64_t n) {
+    if (n < 2)
+        return false;
+    constexpr uint64_t bases[] = {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37};
+    for (uint64_t p : bases) {
+        if (n % p == 0)
+            return n == p;
+    }
+    uint64_t d = n - 1;
+    unsigned s = 0;
+    while (d % 2 == 0) {
+        d /= 2;
+        ++s;
+    }
+    for (uint64_t a : bases) {
+        uint64_t x = pow_mod64(a, d, n);
+        if (x == 1 || x == n - 1)
+            continue;
+        bool composite = true;
+        for (unsigned i = 1; i < s && composite; ++i) {
+            x = multiply_mod64(x, x, n);
+            composite = x != n - 1;
+        }
+        if (composite)
+            return false;
+    }
+    return true;
+}
+
+// A proper divisor of a composite n without small factors: Pollard's rho with Brent's
+// cycle detection, one gcd per 64 steps of the product of the differences.
+constexpr uint64_t pollard_rho(uint64_t n) {
+    for (uint64_t c = 1;; ++c) {
+        auto step = [n, c](uint64_t x) {
+            uint64_t square = multiply_mod64(x, x, n);
+            return square >= n - c ? square - (n - c) : square + c;
+        };
+        uint64_t x = 2;
+        uint64_t y = 2;
+        uint64_t saved = 2;
+        uint64_t product = 1;
+        uint64_t g = 1;
+        for (uint64_t length = 1; g == 1; length *= 2) {
+            x = y;
+            for (uint64_t i = 0; i < length; ++i) {
+                y = step(y);
+            }
+            for (uint64_t done = 0; done < length && g == 1; done += 64) {
+                saved = y;
+                for (uint64_t i = 0; i < 64 && done + i < length; ++i) {
+                    y = step(y);
+                    product = multiply_mod64(product, x > y ? x - y : y - x, n);
+                }
+                g = gcd64(product, n);
+            }
+        }
+        // the batch overshot: redo its steps one gcd at a time
+        if (g == n) {
+            do {
+                saved = step(saved);
+                g = gcd64(x > saved ? x - saved : saved - x, n);
+            } while (g == 1);
+        }
+        if (g != n)
+            return g;
+    }
+}
+
+// A 64-bit number has at most 15 distinct prime divisors; they are listed in order.
+struct prime_factorization64 {
+    unsigned count = 0;
+    uint64_t primes[15] = {};
+    unsigned powers[15] = {};
+};
+
+constexpr prime_factorization64 factorize64(uint64_t n) {
+    prime_factorization64 result;
+    for (uint64_t p = 2; p < 100 && n > 1; ++p) {
+        if (n % p != 0)
+            continue;
+        result.primes[result.count] = p;
+        while (n % p == 0) {
+            n /= p;
+            ++result.powers[result.count];
+        }
+        ++result.count;
+    }
+    // the rest is split by Pollard's rho until every part is prime
+    uint64_t parts[64] = {};
+    unsigned size = 0;
+    if (n > 1)
+        parts[size++] = n;
+    while (size > 0) {
+        uint64_t m = parts[--size];
+        if (!is_prime_number64(m)) {
+            uint64_t d = pollard_rho(m);
+            parts[size++] = d;
+            parts[size++] = m / d;
+            continue;
+        }
+        unsigned i = 0;
+        while (i < result.count && result.primes[i] < m) {
+            ++i;
+        }
+        if (i < result.count && result.primes[i] == m) {
+            ++result.powers[i];
+            continue;
+        }
+        for (unsigned j = result.count; j > i; --j) {
+            result.primes[j] = result.primes[j - 1];
+            result.powers[j] = result.powers[j - 1];
+        }
+        result.primes[i] = m;
+        result.powers[i] = 1;
+        ++result.count;
+    }
+    return result;
+}
+
+constexpr uint64_t euler_function64(uint64_t n) {
+    if (n == 0) return 0;
+    prime_factorization64 f = factorize64(n);
+    for (unsigned i = 0; i < f.count; ++i) {
+        n = n / f.primes[i] * (f.primes[i] - 1);
+    }
+    return n;
+}
+
+constexpr bool has_primitive_root_number64(uint64_t n) {
+    if (n == 2 || n == 4)
+        return true;
+    if (n < 2 || n % 4 == 0)
+        return false;
+    return factorize64(n % 2 == 0 ? n / 2 : n).count == 1;
+}
+
+constexpr uint64_t primitive_root64(uint64_t n) {
+    if (!has_primitive_root_number64(n))
+        return 0;
+    uint64_t EF = euler_function64(n);
+    prime_factorization64 f = factorize64(EF);
+    for (uint64_t g = 1; g < n; ++g) {
+        if (gcd64(g, n) != 1)
+            continue;
+        bool root = true;
+        for (unsigned i = 0; i < f.count && root; ++i) {
+            root = pow_mod64(g, EF / f.primes[i], n) != 1;
+        }
+        if (root)
+            return g;
+    }
+    return 0;
+}
+
+// x with n x = 1 (mod 2^64) for odd n; every Newton step doubles the correct low bits
+constexpr uint64_t inverse_mod_2_64(uint64_t n) {
+    uint64_t x = n;
+    for (int i = 0; i < 5; ++i) {
+        x *= 2 - n * x;
+    }
+    return x;
+}
+
+// x with a x = 1 (mod m) by the extended Euclidean algorithm, 0 when gcd(a, m) != 1.
+constexpr uint64_t inverse_mod64(uint64_t a, uint64_t m) {
+    __int128 r0 = m, r1 = a % m;
+    __int128 t0 = 0, t1 = 1;
+    while (r1 != 0) {
+        __int128 q = r0 / r1;
+        __int128 r = r0 - q * r1;
+        r0 = r1;
+        r1 = r;
+        __int128 t = t0 - q * t1;
+        t0 = t1;
+        t1 = t;
+    }
+    if (r0 != 1)
+        return 0;
+    return t0 < 0 ? t0 + m : t0;
+}
+
+#endif // RESIDUE_H_NUMBER_THEORY_H_
@@ -3,132 +3,31 @@
 #include <cmath>
 #include <assert.h>
 #include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <initializer_list>
+#include <type_traits>
+#include <numeric>
+#include <mutex>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
 
-unsigned euler_function(unsigned N) {
-    if (N == 0) return 0;
-    std::vector<std::pair<unsigned,unsigned>> divisors;
-    unsigned N_copy = N;
-    for (unsigned i = 2; i * i <= N; ++i) {
-        if (N % i == 0) {
-            unsigned cnt = 0;
-            while (N % i == 0) {
-                N /= i;
-                ++cnt;
-            }
-            N_copy /= i;
-            divisors.push_back({i, cnt});
-        }
-    }
-    if (N != 1) {
-        N_copy /= N;
-        divisors.push_back({N, 1});
-    }
-    for (std::pair<unsigned, unsigned> t : divisors) {
-        N_copy *= (t.first - 1);
-    }
-    return N_copy;
-}
-
-template<bool condition>
-struct compilation_error {
-    static int d[condition ? 1 : -1];
-    ~compilation_error() = default;
-};
-
-
-
-
-template<unsigned N, unsigned S>
-struct is_prime_helping {
-    static const bool value =
-            (N % S == 0 ? false : is_prime_helping<N, S - 1>::value);
-    static const int minimal_divisor =
-            (value ? N : is_prime_helping<N, S - 1>::value
-                            ? S
-                            : is_prime_helping<N, S - 1>::minimal_divisor);
-};
-
-template<unsigned N>
-struct is_prime_helping <N, 1> {
-    static const bool value = true;
-    static const int minimal_divisor = N;
-};
+#include "number_theory.h"
 
 template<unsigned N>
 struct is_prime {
-    static const bool value =
-            is_prime_helping<N, static_cast<unsigned>(sqrt(N))>::value;
-};
-
-template<>
-struct is_prime<1> {
-    static const bool value = false;
+    static const bool value = is_prime_number(N);
 };
 
 template<unsigned N>
 const bool is_prime_v = is_prime<N>::value;
 
-template<unsigned N, unsigned P>
-struct is_degree_of_prime {
-    static const bool value =
-            (N % P == 0 ? is_degree_of_prime<N / P, P>::value : false);
-
-};
-
-template<unsigned N>
-struct is_degree_of_prime<N, 1> {
-    static const bool value = false;
-};
-
-template<unsigned N>
-struct is_degree_of_prime<N, 0> {
-    static const bool value = false;
-};
-
-template<unsigned P>
-struct is_degree_of_prime<1, P> {
-    static const bool value = true;
-};
-
-template<unsigned P>
-struct is_degree_of_prime<0, P> {
-    static const bool value = false;
-};
-
-
-template<unsigned N>
-struct is_degree_of_prime_general {
-    static const bool value = is_degree_of_prime<
-            N,
-            is_prime_helping<
-                    N,
-                    static_cast<int>(sqrt(N))>::minimal_divisor>::value;
-};
-
 template<unsigned N>
 struct has_primitive_root {
-    static const bool value =
-            N % 4 == 0
-            ? false
-            : is_degree_of_prime_general<N % 2 == 0 ? N / 2 : N>::value;
+    static const bool value = has_primitive_root_number(N);
 };
 
-template<>
-struct has_primitive_root<1> {
-    static const bool value = false;
-};
-
-template<>
-struct has_primitive_root<2> {
-    static const bool value = true;
-};
-
-template<>
-struct has_primitive_root<4> {
-    static const bool value = true;
-};
-
-
 template<unsigned N>
 const bool has_primitive_root_v = has_primitive_root<N>::value;
 
@@ -145,40 +44,152 @@ struct is_same<T, T> {
 template<typename T, typename U>
 const bool is_same_v = is_same<T, U>::value;
 
-int gcd(int x, int y) {
-    if (x == 0) return y;
-    return gcd(y % x, x);
-}
+template<unsigned N>
+struct residue_batch;
+
+template<unsigned N>
+struct discrete_log_table;
 
+// Products are reduced without division, by a method fixed by N at compile time. Odd N
+// keep number in Montgomery form x R mod N with R = 2^32, so that the product of two forms
+// needs one reduction t / R mod N; even N keep x itself and use Barrett reduction with
+// floor((2^64 - 1) / N). Addition, subtraction and comparison with zero are the same in
+// both, and only the int constructor and conversion translate between x and its form.
 template<unsigned N>
 class Residue {
 private:
+    friend struct residue_batch<N>;
+    friend struct discrete_log_table<N>;
     unsigned int number = 0;
-    static const unsigned EF;
+    static constexpr unsigned EF = euler_function(N);
+
+    static constexpr bool montgomery = N % 2 == 1;
+
+    static constexpr uint32_t n_inverse() {
+        // Newton iteration doubles the number of correct low bits: 3, 6, 12, 24, 48
+        uint32_t inv = N;
+        for (int i = 0; i < 4; ++i) {
+            inv *= 2 - N * inv;
+        }
+        return inv;
+    }
+
+    // R^k mod N for R = 2^32; r1 is the form of 1
+    static constexpr uint32_t r1 = (1ULL << 32) % N;
+    static constexpr uint32_t r2 = 1ULL * r1 * r1 % N;
+    static constexpr uint32_t r3 = 1ULL * r2 * r1 % N;
+    static constexpr uint64_t barrett = ~0ULL / N;
+
+    // t / R mod N for odd N, t mod N otherwise; t < N^2
+    static uint32_t reduce(uint64_t t) {
+        if (montgomery) {
+            // m * N has the same low half as t, so only the high halves are subtracted
+            uint32_t m = static_cast<uint32_t>(t) * n_inverse();
+            uint32_t high = t >> 32;
+            uint32_t correction = (static_cast<uint64_t>(m) * N) >> 32;
+            uint32_t u = high - correction;
+            return high < correction ? u + N : u;
+        }
+        // the quotient is at most one short, so t - q N < 2 N
+        uint64_t q = (static_cast<unsigned __int128>(t) * barrett) >> 64;
+        uint64_t r = t - q * N;
+        return r >= N ? r - N : r;
+    }
+
+    static uint32_t toForm(uint32_t x) {
+        return montgomery ? reduce(static_cast<uint64_t>(x) * r2) : x;
+    }
+
+    static uint32_t fromForm(uint32_t x) {
+        return montgomery ? reduce(x) : x;
+    }
+
+    static Residue<N> fromNumber(uint32_t x) {
+        Residue<N> result;
+        result.number = x;
+        return result;
+    }
+
+    static Residue<N> one() {
+        return fromNumber(montgomery ? r1 : 1 % N);
+    }
+
+    // 2^-k mod N for odd N and k <= 64
+    static constexpr std::array<uint32_t, 65> inversePowersOfTwo() {
+        std::array<uint32_t, 65> result = {};
+        result[0] = 1 % N;
+        for (size_t k = 1; k < result.size(); ++k) {
+            result[k] = multiply_mod(result[k - 1], N / 2 + 1, N);
+        }
+        return result;
+    }
+
+    // Kaliski's almost inverse with the halvings batched by ctz. u and v stay odd and
+    // a r = -sign u 2^k, a s = sign v 2^k (mod N) with sign = +-1; the larger of u, v is
+    // replaced by their difference with its factors of two removed, so the loop runs
+    // O(log N) times without division and the cofactors stay below 2N. Once u = v = 1,
+    // a^-1 = sign s 2^-k. 0 when gcd(a, N) != 1.
+    static uint32_t binaryInverse(uint32_t a) {
+        static constexpr std::array<uint32_t, 65> inverse_powers = inversePowersOfTwo();
+        if (a == 0)
+            return 0;
+        unsigned k = __builtin_ctz(a);
+        uint32_t u = N;
+        uint32_t v = a >> k;
+        uint64_t r = 0;
+        uint64_t s = 1;
+        uint64_t negative = 0;
+        while (u != v) {
+            // the swap is done with masks: the comparison is unpredictable and a branch
+            // on it costs more than the rest of the step
+            int64_t difference = static_cast<int64_t>(u) - v;
+            uint64_t swap = difference >> 63;
+            uint32_t d = (difference ^ swap) - swap;
+            v += difference & swap;
+            uint64_t t = (r ^ s) & swap;
+            r ^= t;
+            s ^= t;
+            negative ^= swap;
+            unsigned z = __builtin_ctz(d);
+            u = d >> z;
+            r += s;
+            s <<= z;
+            k += z;
+        }
+        if (v != 1)
+            return 0;
+        uint32_t x = s % N;
+        if (negative != 0 && x != 0)
+            x = N - x;
+        return multiply_mod(x, inverse_powers[k], N);
+    }
 public:
+    // inputs in (-N, N), the common case, take one conditional add and no division
     explicit Residue(int x) {
-        number = (1LL * x + 1LL * (-x / N  + 2) * N) % N;
+        const long long n = N;
+        long long y = x < 0 ? x + n : x;
+        if (y < 0 || y >= n)
+            y = (x % n + n) % n;
+        number = toForm(y);
     }
 
     Residue(): number(0) {}
 
     explicit operator int() const {
-        int x = number;
+        int x = fromForm(number);
         return x;
     }
 
     Residue<N>& operator=(int x) {
-        number = x;
-        return *this;
+        return *this = Residue<N>(x);
     }
 
-    Residue<N>& operator=(const Residue<N>& x) {
-        number = x.number;
-        return *this;
-    }
+    Residue<N>& operator=(const Residue<N>& x) = default;
 
+    // conditional subtraction instead of % N; the sum may need 33 bits for N > 2^31
     Residue<N>& operator+=(const Residue<N>& x) {
-        number = (x.number + number) % N;
+        uint64_t sum = static_cast<uint64_t>(number) + x.number;
+        number = sum >= N ? sum - N : sum;
         return *this;
     }
 
@@ -189,7 +200,8 @@ public:
     }
 
     Residue<N>& operator-=(const Residue<N>& x) {
-        number = (number - x.number + N) % N;
+        unsigned difference = number - x.number;
+        number = number < x.number ? difference + N : difference;
         return *this;
     }
 
@@ -200,7 +212,7 @@ public:
     }
 
     Residue<N>& operator*=(const Residue<N>& x) {
-        number = (1LL * number * x.number) % N;
+        number = reduce(static_cast<uint64_t>(number) * x.number);
         return *this;
     }
 
@@ -211,20 +223,31 @@ public:
     }
 
     Residue<N> pow(unsigned k) const {
-        if (k == 0)
-            return Residue<N>(1);
-        if (k == 1)
-            return *this;
-        Residue<N> help = pow(k / 2);
-        help *= help;
-        if (k % 2 != 0) help *= *this;
-        return help;
+        Residue<N> result = one();
+        Residue<N> base = *this;
+        for (; k > 0; k >>= 1) {
+            if (k & 1)
+                result *= base;
+            base *= base;
+        }
+        return result;
     }
 
+    bool isInvertible() const {
+        return std::gcd(number, N) == 1;
+    }
+
+    // Any N; asserts that the element is invertible. Odd N use the binary extended GCD,
+    // even N the Euclidean one. The inverse of a form x R is x^-1 R^-1, and one reduction
+    // with R^3 turns it into the form x^-1 R.
     Residue<N> getInverse() const {
-        compilation_error<is_prime_v<N> || number == 0> a;
-        a = a;
-        return pow(N - 2);
+        Residue<N> result;
+        if (montgomery)
+            result.number = reduce(static_cast<uint64_t>(binaryInverse(number)) * r3);
+        else
+            result.number = inverse_mod(number, N);
+        assert(N == 1 || result.number != 0);
+        return result;
     }
 
     Residue<N>& operator/=(const Residue<N>& x) {
@@ -243,17 +266,20 @@ public:
             return 0;
         if (gcd(number, N) != 1)
             return 0;
-        if (number == 1)
+        if (number == one().number)
             return 1;
-//
+
+        // the order divides EF: strip every prime factor of EF that is not needed
+        constexpr prime_factorization f = factorize(EF);
         unsigned int ans = EF;
-        for (unsigned i = 1; i * i <= EF; ++i) {
-            if (static_cast<int>(pow(i)) == 1)
-                ans = std::min(ans, i);
-            if (static_cast<int>(pow(EF / i)) == 1)
-                ans = std::min(ans, EF / i);
+        for (unsigned i = 0; i < f.count; ++i) {
+            for (unsigned k = 0; k < f.powers[i]; ++k) {
+                if (pow(ans / f.primes[i]).number != one().number)
+                    break;
+                ans /= f.primes[i];
+            }
         }
-        assert(static_cast<int>(pow(ans)) == 1);
+        assert(pow(ans).number == one().number);
         return ans;
     }
 
@@ -261,13 +287,763 @@ public:
         compilation_error<has_primitive_root_v<N>> a;
         a = a;
 
-        for (unsigned i = 1; i < N; ++i) {
-            if (Residue<N>(i).order() == EF)
-                return Residue<N>(i);
+        constexpr unsigned root = primitive_root(N);
+        return Residue<N>(root);
+    }
+
+    // Euler's criterion
+    bool isSquare() const {
+        compilation_error<is_prime_v<N>> a;
+        a = a;
+        return number == 0 || N == 2 || pow((N - 1) / 2).number == one().number;
+    }
+
+    // The smaller of the two square roots, by Tonelli-Shanks: t = x^q lies in the Sylow
+    // 2-subgroup and every step halves its order while keeping root^2 = x t.
+    Residue<N> sqrt() const {
+        compilation_error<is_prime_v<N>> a;
+        a = a;
+        assert(isSquare());
+        if (number == 0 || N == 2)
+            return *this;
+
+        constexpr square_root_constants c = tonelli_shanks_constants(N);
+        Residue<N> z = fromNumber(toForm(c.root));
+        Residue<N> t = pow(c.q);
+        Residue<N> root = pow((c.q + 1) / 2);
+        unsigned m = c.s;
+        while (t.number != one().number) {
+            unsigned i = 0;
+            for (Residue<N> u = t; u.number != one().number; u *= u) {
+                ++i;
+            }
+            Residue<N> b = z;
+            for (unsigned j = i + 1; j < m; ++j) {
+                b *= b;
+            }
+            m = i;
+            z = b * b;
+            t *= z;
+            root *= b;
+        }
+        uint32_t x = fromForm(root.number);
+        return N - x < x ? Residue<N>() - root : root;
+    }
+
+    // The smallest k >= 0 with base^k = *this, -1 when there is none. Both logarithms
+    // are taken to the primitive root, which turns the question into k log(base) = log(x)
+    // modulo EF; the tables behind them are built once per N.
+    long long log(const Residue<N>& base) const {
+        compilation_error<has_primitive_root_v<N>> a;
+        a = a;
+        if (gcd(number, N) != 1 || gcd(base.number, N) != 1)
+            return -1;
+
+        const discrete_log_table<N>& table = discrete_log_table<N>::get();
+        uint64_t x = table.log(*this);
+        uint64_t b = table.log(base);
+        uint64_t d = std::gcd(b, static_cast<uint64_t>(EF));
+        if (x % d != 0)
+            return -1;
+        uint32_t m = EF / d;
+        return x / d * inverse_mod(b / d % m, m) % m;
+    }
+};
+
+// Pohlig-Hellman over the primitive root g. For every p^e dividing EF the subgroup of
+// order p^e is generated by g^(EF / p^e); a logarithm there is found one base-p digit at
+// a time, each digit by baby-step giant-step in the subgroup of order p, and the digits
+// are combined across the prime powers by the Chinese remainder theorem. The baby steps
+// are kept sorted, so a query costs O(sum e sqrt(p) log p) multiplications.
+template<unsigned N>
+struct discrete_log_table {
+    struct subgroup {
+        unsigned p = 0;
+        unsigned e = 0;
+        unsigned pe = 0;
+        // generator of order p^e and its inverse
+        Residue<N> generator;
+        Residue<N> inverse;
+        // generator^(p^(e - 1)), of order p
+        Residue<N> gamma;
+        // gamma^j for j < steps, sorted by value, and gamma^(-steps)
+        unsigned steps = 0;
+        std::vector<std::pair<unsigned, unsigned>> baby;
+        Residue<N> giant;
+    };
+
+    std::vector<subgroup> subgroups;
+
+    discrete_log_table() {
+        constexpr unsigned EF = Residue<N>::EF;
+        constexpr prime_factorization f = factorize(EF);
+        Residue<N> g = Residue<N>::getPrimitiveRoot();
+        for (unsigned i = 0; i < f.count; ++i) {
+            subgroup s;
+            s.p = f.primes[i];
+            s.e = f.powers[i];
+            s.pe = 1;
+            for (unsigned k = 0; k < s.e; ++k) {
+                s.pe *= s.p;
+            }
+            s.generator = g.pow(EF / s.pe);
+            s.inverse = s.generator.pow(s.pe - 1);
+            s.gamma = s.generator.pow(s.pe / s.p);
+            s.steps = static_cast<unsigned>(std::ceil(std::sqrt(static_cast<double>(s.p))));
+            s.baby.resize(s.steps);
+            Residue<N> power(1);
+            for (unsigned j = 0; j < s.steps; ++j) {
+                s.baby[j] = {power.number, j};
+                power *= s.gamma;
+            }
+            std::sort(s.baby.begin(), s.baby.end());
+            s.giant = s.gamma.pow((s.p - s.steps % s.p) % s.p);
+            subgroups.push_back(s);
+        }
+    }
+
+    static const discrete_log_table<N>& get() {
+        static const discrete_log_table<N> table;
+        return table;
+    }
+
+    // k < p with gamma^k = h
+    static unsigned subgroupLog(const subgroup& s, Residue<N> h) {
+        for (unsigned i = 0; i <= s.steps; ++i) {
+            auto it = std::lower_bound(s.baby.begin(), s.baby.end(), std::make_pair(h.number, 0u));
+            if (it != s.baby.end() && it->first == h.number)
+                return i * s.steps + it->second;
+            h *= s.giant;
+        }
+        assert(false);
+        return 0;
+    }
+
+    // k < EF with g^k = x for a unit x
+    unsigned log(const Residue<N>& x) const {
+        uint64_t result = 0;
+        uint64_t modulus = 1;
+        for (const subgroup& s : subgroups) {
+            Residue<N> y = x.pow(Residue<N>::EF / s.pe);
+            // digits k_0 + k_1 p + ... of the logarithm of y to the generator
+            unsigned k = 0;
+            unsigned digit_weight = 1;
+            for (unsigned i = 0; i < s.e; ++i) {
+                Residue<N> h = (y * s.inverse.pow(k)).pow(s.pe / s.p / digit_weight);
+                k += subgroupLog(s, h) * digit_weight;
+                digit_weight *= s.p;
+            }
+            // result = k (mod p^e), keeping the residue modulo the earlier prime powers
+            uint64_t t = (k + s.pe - result % s.pe) % s.pe * inverse_mod(modulus % s.pe, s.pe) % s.pe;
+            result += t * modulus;
+            modulus *= s.pe;
+        }
+        return result;
+    }
+};
+
+// Batch arithmetic over contiguous arrays of Residue<N>; result may alias an input.
+// With AVX2 and odd N < 2^31 eight residues are multiplied at once in Montgomery form:
+// mul_epu32 gives the 64-bit products of the even and odd lanes, m = t * N^-1 mod 2^32
+// makes t - m * N divisible by 2^32, and its high half lies in (-N, N). Residue<N> keeps
+// odd N in that form already, so the lanes are loaded and stored as they are. Other N
+// and the tails go through the scalar operators.
+template<unsigned N>
+struct residue_batch {
+    static constexpr bool montgomery = N % 2 == 1 && N < (1u << 31);
+
+    // R mod N for R = 2^32, the form of 1
+    static constexpr uint32_t r1 = Residue<N>::r1;
+
+#ifdef __AVX2__
+    static __m256i load(const Residue<N>* a) {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&a->number));
+    }
+
+    static void store(Residue<N>* a, __m256i x) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(&a->number), x);
+    }
+
+    // a * b / R mod N
+    static __m256i multiply8(__m256i a, __m256i b) {
+        const __m256i n = _mm256_set1_epi32(N);
+        const __m256i n_inv = _mm256_set1_epi32(Residue<N>::n_inverse());
+        __m256i t_even = _mm256_mul_epu32(a, b);
+        __m256i t_odd = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), _mm256_srli_epi64(b, 32));
+        __m256i d_even = _mm256_sub_epi64(t_even, _mm256_mul_epu32(_mm256_mul_epu32(t_even, n_inv), n));
+        __m256i d_odd = _mm256_sub_epi64(t_odd, _mm256_mul_epu32(_mm256_mul_epu32(t_odd, n_inv), n));
+        __m256i u = _mm256_blend_epi32(_mm256_srli_epi64(d_even, 32), d_odd, 0xAA);
+        return _mm256_add_epi32(u, _mm256_and_si256(_mm256_cmpgt_epi32(_mm256_setzero_si256(), u), n));
+    }
+
+    // a + b mod N: if the sum is below N, subtracting N wraps above it
+    static __m256i add8(__m256i a, __m256i b) {
+        __m256i s = _mm256_add_epi32(a, b);
+        return _mm256_min_epu32(s, _mm256_sub_epi32(s, _mm256_set1_epi32(N)));
+    }
+
+    // a - b mod N: if a < b the difference wraps above the corrected one
+    static __m256i sub8(__m256i a, __m256i b) {
+        __m256i d = _mm256_sub_epi32(a, b);
+        return _mm256_min_epu32(d, _mm256_add_epi32(d, _mm256_set1_epi32(N)));
+    }
+#endif
+
+    static void mul(Residue<N>* result, const Residue<N>* a, const Residue<N>* b, size_t n) {
+        size_t i = 0;
+#ifdef __AVX2__
+        if (montgomery) {
+            for (; i + 8 <= n; i += 8) {
+                store(result + i, multiply8(load(a + i), load(b + i)));
+            }
+        }
+#endif
+        for (; i < n; ++i) {
+            result[i] = a[i] * b[i];
+        }
+    }
+
+    static void add(Residue<N>* result, const Residue<N>* a, const Residue<N>* b, size_t n) {
+        size_t i = 0;
+#ifdef __AVX2__
+        if (N < (1u << 31)) {
+            for (; i + 8 <= n; i += 8) {
+                store(result + i, add8(load(a + i), load(b + i)));
+            }
+        }
+#endif
+        for (; i < n; ++i) {
+            result[i] = a[i] + b[i];
+        }
+    }
+
+    static void axpy(Residue<N>* y, const Residue<N>& alpha, const Residue<N>* x, size_t n) {
+        size_t i = 0;
+#ifdef __AVX2__
+        if (montgomery) {
+            const __m256i alpha_form = _mm256_set1_epi32(alpha.number);
+            for (; i + 8 <= n; i += 8) {
+                store(y + i, add8(load(y + i), multiply8(load(x + i), alpha_form)));
+            }
+        }
+#endif
+        for (; i < n; ++i) {
+            y[i] += alpha * x[i];
+        }
+    }
+
+    static void scale(Residue<N>* result, const Residue<N>& alpha, const Residue<N>* a, size_t n) {
+        size_t i = 0;
+#ifdef __AVX2__
+        if (montgomery) {
+            const __m256i alpha_form = _mm256_set1_epi32(alpha.number);
+            for (; i + 8 <= n; i += 8) {
+                store(result + i, multiply8(load(a + i), alpha_form));
+            }
+        }
+#endif
+        for (; i < n; ++i) {
+            result[i] = alpha * a[i];
+        }
+    }
+
+    static void pow(Residue<N>* result, const Residue<N>* a, unsigned k, size_t n) {
+        size_t i = 0;
+#ifdef __AVX2__
+        if (montgomery) {
+            for (; i + 8 <= n; i += 8) {
+                __m256i base = load(a + i);
+                __m256i power = _mm256_set1_epi32(r1);
+                for (unsigned e = k; e > 0; e >>= 1) {
+                    if (e & 1)
+                        power = multiply8(power, base);
+                    base = multiply8(base, base);
+                }
+                store(result + i, power);
+            }
+        }
+#endif
+        for (; i < n; ++i) {
+            result[i] = a[i].pow(k);
+        }
+    }
+
+    // Montgomery's trick: prefix products, one inversion, then two multiplications per
+    // element on the way back. Zeros are left out of the product and map to zero.
+    static void inverse(Residue<N>* result, const Residue<N>* a, size_t n) {
+        std::vector<Residue<N>> prefix(n);
+        Residue<N> product(1);
+        for (size_t i = 0; i < n; ++i) {
+            prefix[i] = product;
+            if (a[i].number != 0)
+                product *= a[i];
+        }
+        Residue<N> inv = product.getInverse();
+        for (size_t i = n; i-- > 0;) {
+            if (a[i].number == 0) {
+                result[i] = Residue<N>();
+                continue;
+            }
+            Residue<N> x = a[i];
+            result[i] = inv * prefix[i];
+            inv *= x;
         }
-        return Residue<N>(0);
     }
 };
 
-template <unsigned N>
-const unsigned Residue<N>::EF = euler_function(N);
+template<unsigned N>
+void mul_n(Residue<N>* result, const Residue<N>* a, const Residue<N>* b, size_t n) {
+    residue_batch<N>::mul(result, a, b, n);
+}
+
+template<unsigned N>
+void add_n(Residue<N>* result, const Residue<N>* a, const Residue<N>* b, size_t n) {
+    residue_batch<N>::add(result, a, b, n);
+}
+
+// y += alpha * x
+template<unsigned N>
+void axpy_n(Residue<N>* y, const Residue<N>& alpha, const Residue<N>* x, size_t n) {
+    residue_batch<N>::axpy(y, alpha, x, n);
+}
+
+template<unsigned N>
+void pow_n(Residue<N>* result, const Residue<N>* a, unsigned k, size_t n) {
+    residue_batch<N>::pow(result, a, k, n);
+}
+
+template<unsigned N>
+void batch_inverse(Residue<N>* result, const Residue<N>* a, size_t n) {
+    compilation_error<is_prime_v<N>> check;
+    check = check;
+    residue_batch<N>::inverse(result, a, n);
+}
+
+#include "dynamic_residue.h"
+
+#include "residue64.h"
+
+// Dense polynomials over Residue<P> for P < 2^31, coefficients from x^0 up and without
+// trailing zeros. Products use the number-theoretic transform when P is a prime with
+// 2^k | P - 1 for the transform size, and otherwise three NTT primes whose product exceeds
+// every coefficient of the integer product, combined by Garner's algorithm. Inverse,
+// division, log and exp are Newton iterations on top of the product, so they cost O(M(n)).
+template<typename Field>
+class Polynomial;
+
+template<unsigned P>
+class Polynomial<Residue<P>> {
+private:
+    typedef residue_batch<P> batch;
+    std::vector<Residue<P>> coefficients;
+
+    void trim() {
+        while (!coefficients.empty() && static_cast<int>(coefficients.back()) == 0) {
+            coefficients.pop_back();
+        }
+    }
+
+    // omega^j for j < n, omega a primitive root of unity of order n, with the Montgomery
+    // forms omega^j * 2^32 that feed the AVX2 butterflies.
+    struct RootTable {
+        std::vector<Residue<P>> roots;
+        std::vector<uint32_t> forms;
+    };
+
+    // One table per power-of-two length, built on first use under call_once and never changed
+    // afterwards, so transforms in several threads share them without locking.
+    static const RootTable& rootTable(size_t n) {
+        static std::once_flag built[32];
+        static RootTable tables[32];
+        const unsigned level = __builtin_ctzll(n);
+        std::call_once(built[level], [n, level]() {
+            assert((P - 1) % n == 0);
+            RootTable& table = tables[level];
+            Residue<P> omega = Residue<P>::getPrimitiveRoot().pow((P - 1) / n);
+            table.roots.assign(n, Residue<P>(1));
+            for (size_t j = 1; j < n; ++j) {
+                table.roots[j] = table.roots[j - 1] * omega;
+            }
+            table.forms.resize(n);
+            for (size_t j = 0; j < n; ++j) {
+                table.forms[j] = 1ULL * static_cast<int>(table.roots[j]) * batch::r1 % P;
+            }
+        });
+        return tables[level];
+    }
+
+    // One Stockham radix-4 pass: x[q + s (p + r m)] -> y[q + s (4 p + r)] with the
+    // twiddles omega_len^(r p), len = 4 m. The result of the whole transform comes out in
+    // natural order, no bit reversal pass.
+    static void radix4(const RootTable& table, const Residue<P>* x, Residue<P>* y, size_t m, size_t s, bool invert) {
+        const std::vector<Residue<P>>& w = table.roots;
+        const std::vector<uint32_t>& forms = table.forms;
+        const size_t total = w.size();
+        // omega_len^m, a primitive 4th root of unity
+        const size_t quarter = invert ? total - total / 4 : total / 4;
+        const Residue<P> J = w[quarter];
+        for (size_t p = 0; p < m; ++p) {
+            size_t e = s * p;
+            size_t e1 = invert ? (total - e) % total : e;
+            size_t e2 = invert ? (total - 2 * e) % total : 2 * e;
+            size_t e3 = invert ? (total - 3 * e) % total : 3 * e;
+            const Residue<P>* in = x + s * p;
+            Residue<P>* out = y + 4 * s * p;
+            size_t q = 0;
+#ifdef __AVX2__
+            if (batch::montgomery && s >= 8) {
+                const __m256i j_form = _mm256_set1_epi32(forms[quarter]);
+                const __m256i w1 = _mm256_set1_epi32(forms[e1]);
+                const __m256i w2 = _mm256_set1_epi32(forms[e2]);
+                const __m256i w3 = _mm256_set1_epi32(forms[e3]);
+                for (; q + 8 <= s; q += 8) {
+                    __m256i a = batch::load(in + q);
+                    __m256i b = batch::load(in + q + s * m);
+                    __m256i c = batch::load(in + q + 2 * s * m);
+                    __m256i d = batch::load(in + q + 3 * s * m);
+                    __m256i apc = batch::add8(a, c);
+                    __m256i amc = batch::sub8(a, c);
+                    __m256i bpd = batch::add8(b, d);
+                    __m256i jbmd = batch::multiply8(batch::sub8(b, d), j_form);
+                    batch::store(out + q, batch::add8(apc, bpd));
+                    batch::store(out + q + s, batch::multiply8(batch::add8(amc, jbmd), w1));
+                    batch::store(out + q + 2 * s, batch::multiply8(batch::sub8(apc, bpd), w2));
+                    batch::store(out + q + 3 * s, batch::multiply8(batch::sub8(amc, jbmd), w3));
+                }
+            }
+#else
+            (void)forms;
+#endif
+            for (; q < s; ++q) {
+                Residue<P> a = in[q];
+                Residue<P> b = in[q + s * m];
+                Residue<P> c = in[q + 2 * s * m];
+                Residue<P> d = in[q + 3 * s * m];
+                Residue<P> apc = a + c;
+                Residue<P> amc = a - c;
+                Residue<P> bpd = b + d;
+                Residue<P> jbmd = (b - d) * J;
+                out[q] = apc + bpd;
+                out[q + s] = (amc + jbmd) * w[e1];
+                out[q + 2 * s] = (apc - bpd) * w[e2];
+                out[q + 3 * s] = (amc - jbmd) * w[e3];
+            }
+        }
+    }
+
+    // The last pass when log2 n is odd: len = 2, so the only twiddle is 1.
+    static void radix2(const Residue<P>* x, Residue<P>* y, size_t s) {
+        batch::add(y, x, x + s, s);
+        for (size_t q = 0; q < s; ++q) {
+            y[q + s] = x[q] - x[q + s];
+        }
+    }
+
+    // In-place transform of a power-of-two length n, buffer of the same length; the
+    // inverse transform is not scaled by 1 / n.
+    static void transform(Residue<P>* a, Residue<P>* buffer, size_t n, bool invert) {
+        const RootTable& table = rootTable(n);
+        Residue<P>* x = a;
+        Residue<P>* y = buffer;
+        size_t len = n;
+        size_t s = 1;
+        for (; len >= 4; len /= 4, s *= 4) {
+            radix4(table, x, y, len / 4, s, invert);
+            std::swap(x, y);
+        }
+        if (len == 2) {
+            radix2(x, y, s);
+            std::swap(x, y);
+        }
+        if (x != a)
+            std::copy(x, x + n, a);
+    }
+
+    static std::vector<Residue<P>> naiveProduct(const std::vector<Residue<P>>& a, const std::vector<Residue<P>>& b) {
+        std::vector<Residue<P>> result(a.size() + b.size() - 1);
+        for (size_t i = 0; i < a.size(); ++i) {
+            batch::axpy(result.data() + i, a[i], b.data(), b.size());
+        }
+        return result;
+    }
+
+    static std::vector<Residue<P>> transformProduct(std::vector<Residue<P>> a, std::vector<Residue<P>> b, size_t n) {
+        size_t size = a.size() + b.size() - 1;
+        a.resize(n);
+        b.resize(n);
+        std::vector<Residue<P>> buffer(n);
+        transform(a.data(), buffer.data(), n, false);
+        transform(b.data(), buffer.data(), n, false);
+        batch::mul(a.data(), a.data(), b.data(), n);
+        transform(a.data(), buffer.data(), n, true);
+        batch::scale(a.data(), Residue<P>(static_cast<int>(n)).getInverse(), a.data(), size);
+        a.resize(size);
+        return a;
+    }
+
+    template<unsigned Q>
+    static std::vector<Residue<Q>> productModulo(const std::vector<Residue<P>>& a, const std::vector<Residue<P>>& b) {
+        std::vector<Residue<Q>> a_q(a.size());
+        std::vector<Residue<Q>> b_q(b.size());
+        for (size_t i = 0; i < a.size(); ++i) {
+            a_q[i] = Residue<Q>(static_cast<int>(a[i]));
+        }
+        for (size_t i = 0; i < b.size(); ++i) {
+            b_q[i] = Residue<Q>(static_cast<int>(b[i]));
+        }
+        return Polynomial<Residue<Q>>::product(a_q, b_q);
+    }
+
+    // Coefficients of the integer product are below n (P - 1)^2 < P1 P2 P3 for
+    // n <= 2^23 and P < 2^31; larger moduli do not compile.
+    static std::vector<Residue<P>> crtProduct(const std::vector<Residue<P>>& a, const std::vector<Residue<P>>& b) {
+        compilation_error<(P < (1u << 31))> check;
+        check = check;
+        const unsigned P1 = 998244353;
+        const unsigned P2 = 167772161;
+        const unsigned P3 = 469762049;
+        const uint32_t P1_inverse_2 = pow_mod(P1, P2 - 2, P2);
+        const uint32_t P1_inverse_3 = pow_mod(P1, P3 - 2, P3);
+        const uint32_t P2_inverse_3 = pow_mod(P2, P3 - 2, P3);
+        const uint64_t P1P2 = 1ULL * P1 * P2 % P;
+        assert(a.size() + b.size() - 1 <= (1u << 23));
+        std::vector<Residue<P1>> c1 = productModulo<P1>(a, b);
+        std::vector<Residue<P2>> c2 = productModulo<P2>(a, b);
+        std::vector<Residue<P3>> c3 = productModulo<P3>(a, b);
+        std::vector<Residue<P>> result(c1.size());
+        for (size_t i = 0; i < result.size(); ++i) {
+            // x = v1 + v2 P1 + v3 P1 P2 with v_k < P_k
+            uint64_t v1 = static_cast<int>(c1[i]);
+            uint64_t v2 = (static_cast<int>(c2[i]) + P2 - v1 % P2) * P1_inverse_2 % P2;
+            uint64_t v3 = (static_cast<int>(c3[i]) + P3 - (v1 + v2 * P1) % P3) % P3 * P1_inverse_3 % P3 * P2_inverse_3 % P3;
+            result[i] = Residue<P>(static_cast<int>((v1 % P + v2 * P1 % P + v3 * P1P2) % P));
+        }
+        return result;
+    }
+
+    // 1, 1/2, ..., 1/n by inv(i) = -(P / i) inv(P mod i)
+    static std::vector<Residue<P>> inversesUpTo(size_t n) {
+        assert(n < P);
+        std::vector<Residue<P>> inv(n + 1);
+        if (n >= 1)
+            inv[1] = Residue<P>(1);
+        for (size_t i = 2; i <= n; ++i) {
+            inv[i] = Residue<P>(0) - Residue<P>(static_cast<int>(P / i)) * inv[P % i];
+        }
+        return inv;
+    }
+
+    // the transform needs a prime P; composite moduli always go through the three primes
+    static std::vector<Residue<P>> largeProduct(const std::vector<Residue<P>>& a, const std::vector<Residue<P>>& b,
+                                                size_t n, std::true_type) {
+        if ((P - 1) % n == 0)
+            return transformProduct(a, b, n);
+        return crtProduct(a, b);
+    }
+
+    static std::vector<Residue<P>> largeProduct(const std::vector<Residue<P>>& a, const std::vector<Residue<P>>& b,
+                                                size_t, std::false_type) {
+        return crtProduct(a, b);
+    }
+
+public:
+    Polynomial() {}
+
+    explicit Polynomial(const std::vector<Residue<P>>& c): coefficients(c) {
+        trim();
+    }
+
+    Polynomial(const std::initializer_list<int>& c) {
+        for (int x : c) {
+            coefficients.push_back(Residue<P>(x));
+        }
+        trim();
+    }
+
+    size_t size() const {
+        return coefficients.size();
+    }
+
+    // -1 for the zero polynomial
+    int degree() const {
+        return static_cast<int>(coefficients.size()) - 1;
+    }
+
+    Residue<P> operator[](size_t i) const {
+        return i < coefficients.size() ? coefficients[i] : Residue<P>(0);
+    }
+
+    const std::vector<Residue<P>>& data() const {
+        return coefficients;
+    }
+
+    static std::vector<Residue<P>> product(const std::vector<Residue<P>>& a, const std::vector<Residue<P>>& b) {
+        if (a.empty() || b.empty())
+            return std::vector<Residue<P>>();
+        if (std::min(a.size(), b.size()) <= 32)
+            return naiveProduct(a, b);
+        size_t n = 1;
+        while (n < a.size() + b.size() - 1) {
+            n *= 2;
+        }
+        return largeProduct(a, b, n, std::integral_constant<bool, is_prime_v<P>>());
+    }
+
+    Polynomial<Residue<P>>& operator+=(const Polynomial<Residue<P>>& x) {
+        if (coefficients.size() < x.size())
+            coefficients.resize(x.size());
+        batch::add(coefficients.data(), coefficients.data(), x.coefficients.data(), x.size());
+        trim();
+        return *this;
+    }
+
+    Polynomial<Residue<P>> operator+(const Polynomial<Residue<P>>& x) const {
+        Polynomial<Residue<P>> a = *this;
+        a += x;
+        return a;
+    }
+
+    Polynomial<Residue<P>>& operator-=(const Polynomial<Residue<P>>& x) {
+        if (coefficients.size() < x.size())
+            coefficients.resize(x.size());
+        for (size_t i = 0; i < x.size(); ++i) {
+            coefficients[i] -= x.coefficients[i];
+        }
+        trim();
+        return *this;
+    }
+
+    Polynomial<Residue<P>> operator-(const Polynomial<Residue<P>>& x) const {
+        Polynomial<Residue<P>> a = *this;
+        a -= x;
+        return a;
+    }
+
+    Polynomial<Residue<P>>& operator*=(const Polynomial<Residue<P>>& x) {
+        coefficients = product(coefficients, x.coefficients);
+        trim();
+        return *this;
+    }
+
+    Polynomial<Residue<P>> operator*(const Polynomial<Residue<P>>& x) const {
+        Polynomial<Residue<P>> a = *this;
+        a *= x;
+        return a;
+    }
+
+    bool operator==(const Polynomial<Residue<P>>& x) const {
+        if (size() != x.size())
+            return false;
+        for (size_t i = 0; i < size(); ++i) {
+            if (static_cast<int>(coefficients[i]) != static_cast<int>(x.coefficients[i]))
+                return false;
+        }
+        return true;
+    }
+
+    bool operator!=(const Polynomial<Residue<P>>& x) const {
+        return !(*this == x);
+    }
+
+    // this mod x^n
+    Polynomial<Residue<P>> truncated(size_t n) const {
+        Polynomial<Residue<P>> a;
+        a.coefficients.assign(coefficients.begin(), coefficients.begin() + std::min(n, size()));
+        a.trim();
+        return a;
+    }
+
+    Residue<P> evaluate(const Residue<P>& x) const {
+        Residue<P> result(0);
+        for (size_t i = size(); i-- > 0;) {
+            result = result * x + coefficients[i];
+        }
+        return result;
+    }
+
+    Polynomial<Residue<P>> derivative() const {
+        Polynomial<Residue<P>> a;
+        for (size_t i = 1; i < size(); ++i) {
+            a.coefficients.push_back(coefficients[i] * Residue<P>(static_cast<int>(i)));
+        }
+        a.trim();
+        return a;
+    }
+
+    Polynomial<Residue<P>> integral() const {
+        std::vector<Residue<P>> inv = inversesUpTo(size());
+        Polynomial<Residue<P>> a;
+        a.coefficients.resize(size() + 1);
+        for (size_t i = 0; i < size(); ++i) {
+            a.coefficients[i + 1] = coefficients[i] * inv[i + 1];
+        }
+        a.trim();
+        return a;
+    }
+
+    // g with this * g = 1 mod x^n, by g <- g (2 - this g) doubling the precision each step
+    Polynomial<Residue<P>> inverse(size_t n) const {
+        assert(!coefficients.empty() && static_cast<int>(coefficients[0]) != 0);
+        Polynomial<Residue<P>> g;
+        g.coefficients.push_back(coefficients[0].getInverse());
+        for (size_t k = 1; k < n;) {
+            k *= 2;
+            Polynomial<Residue<P>> t = (truncated(k) * g).truncated(k);
+            t = Polynomial<Residue<P>>{2} - t;
+            g = (g * t).truncated(k);
+        }
+        return g.truncated(n);
+    }
+
+    // Quotient of the division with remainder: the reversed polynomials turn it into a
+    // power series division mod x^(deg this - deg x + 1).
+    Polynomial<Residue<P>> operator/(const Polynomial<Residue<P>>& x) const {
+        assert(x.size() != 0);
+        if (size() < x.size())
+            return Polynomial<Residue<P>>();
+        size_t m = size() - x.size() + 1;
+        if (x.size() <= 32) {
+            // long division, deg x multiplications per quotient coefficient
+            std::vector<Residue<P>> rest = coefficients;
+            std::vector<Residue<P>> quotient(m);
+            Residue<P> lead = x.coefficients.back().getInverse();
+            for (size_t i = m; i-- > 0;) {
+                quotient[i] = rest[i + x.size() - 1] * lead;
+                for (size_t j = 0; j < x.size(); ++j) {
+                    rest[i + j] -= quotient[i] * x.coefficients[j];
+                }
+            }
+            return Polynomial<Residue<P>>(quotient);
+        }
+        std::vector<Residue<P>> a(coefficients.rbegin(), coefficients.rend());
+        std::vector<Residue<P>> b(x.coefficients.rbegin(), x.coefficients.rend());
+        a.resize(m);
+        Polynomial<Residue<P>> q = (Polynomial<Residue<P>>(a) * Polynomial<Residue<P>>(b).inverse(m)).truncated(m);
+        q.coefficients.resize(m);
+        std::reverse(q.coefficients.begin(), q.coefficients.end());
+        q.trim();
+        return q;
+    }
+
+    Polynomial<Residue<P>> operator%(const Polynomial<Residue<P>>& x) const {
+        return (*this - *this / x * x).truncated(x.size() - 1);
+    }
+
+    // log(this) mod x^n for this(0) = 1: the integral of this' / this
+    Polynomial<Residue<P>> log(size_t n) const {
+        assert(static_cast<int>((*this)[0]) == 1);
+        return (derivative() * inverse(n)).truncated(n - 1).integral();
+    }
+
+    // exp(this) mod x^n for this(0) = 0, by g <- g (1 - log g + this)
+    Polynomial<Residue<P>> exp(size_t n) const {
+        assert(static_cast<int>((*this)[0]) == 0);
+        Polynomial<Residue<P>> g{1};
+        for (size_t k = 1; k < n;) {
+            k *= 2;
+            Polynomial<Residue<P>> t = truncated(k) - g.log(k) + Polynomial<Residue<P>>{1};
+            g = (g * t).truncated(k);
+        }
+        return g.truncated(n);
+    }
+};
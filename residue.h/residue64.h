@@ -0,0 +1,243 @@
+// Shared by residue.h and matrix.h: residues modulo a 64-bit N fixed at compile time.
+#ifndef RESIDUE_H_RESIDUE64_H_
+#define RESIDUE_H_RESIDUE64_H_
+
+#include "number_theory.h"
+
+#include <array>
+#include <assert.h>
+#include <iostream>
+
+// Residue modulo an odd N < 2^64, kept in Montgomery form x 2^64 mod N: a product is one
+// 128-bit multiplication and a reduction without division. N^-1 mod 2^64 and the
+// conversion factor R^2 = 2^128 mod N are compile-time constants.
+template<uint64_t N>
+class Residue64 {
+private:
+    uint64_t number = 0;
+    static constexpr uint64_t EF = euler_function64(N);
+    static constexpr uint64_t n_inverse = inverse_mod_2_64(N);
+    // 2^64 mod N and 2^128 mod N
+    static constexpr uint64_t r1 = (0 - N) % N;
+    static constexpr uint64_t r2 = multiply_mod64(r1, r1, N);
+
+    // t 2^-64 mod N for t < N 2^64: the low halves of t and m N agree, so only the high
+    // halves are subtracted
+    static uint64_t reduce(unsigned __int128 t) {
+        compilation_error<N % 2 == 1> a;
+        a = a;
+        uint64_t m = static_cast<uint64_t>(t) * n_inverse;
+        uint64_t mn = (static_cast<unsigned __int128>(m) * N) >> 64;
+        uint64_t high = t >> 64;
+        return high >= mn ? high - mn : high - mn + N;
+    }
+
+    static uint64_t multiply(uint64_t a, uint64_t b) {
+        return reduce(static_cast<unsigned __int128>(a) * b);
+    }
+
+    // 2^-k R^3 mod N for k <= 128
+    static constexpr std::array<uint64_t, 129> inversePowersOfTwo() {
+        std::array<uint64_t, 129> result = {};
+        result[0] = multiply_mod64(r2, r1, N);
+        for (size_t k = 1; k < result.size(); ++k) {
+            result[k] = multiply_mod64(result[k - 1], N / 2 + 1, N);
+        }
+        return result;
+    }
+
+    // Kaliski's almost inverse with the halvings batched by ctz. u and v stay odd,
+    // a r = -sign u 2^k and a s = sign v 2^k (mod N), and u s + v r = N, so the cofactors
+    // fit in a word; the swap is done with masks since the comparison is unpredictable.
+    // The argument is a stored y = x R and the table folds in R^3, so one Montgomery
+    // product turns y^-1 2^k into x^-1 R. 0 when gcd(y, N) != 1.
+    static uint64_t binaryInverse(uint64_t a) {
+        static constexpr std::array<uint64_t, 129> inverse_powers = inversePowersOfTwo();
+        if (a == 0)
+            return 0;
+        unsigned k = __builtin_ctzll(a);
+        uint64_t u = N;
+        uint64_t v = a >> k;
+        uint64_t r = 0;
+        uint64_t s = 1;
+        uint64_t negative = 0;
+        while (u != v) {
+            __int128 difference = static_cast<__int128>(u) - v;
+            uint64_t swap = static_cast<uint64_t>(difference >> 64);
+            uint64_t d = (static_cast<uint64_t>(difference) ^ swap) - swap;
+            v += static_cast<uint64_t>(difference) & swap;
+            uint64_t t = (r ^ s) & swap;
+            r ^= t;
+            s ^= t;
+            negative ^= swap;
+            unsigned z = __builtin_ctzll(d);
+            u = d >> z;
+            r += s;
+            s <<= z;
+            k += z;
+        }
+        if (v != 1)
+            return 0;
+        uint64_t x = s == N ? 0 : s;
+        if (negative != 0 && x != 0)
+            x = N - x;
+        return multiply(x, inverse_powers[k]);
+    }
+
+public:
+    explicit Residue64(long long x) {
+        uint64_t magnitude = x < 0 ? 0 - static_cast<uint64_t>(x) : x;
+        uint64_t value = magnitude % N;
+        if (x < 0 && value != 0)
+            value = N - value;
+        number = multiply(value, r2);
+    }
+
+    Residue64(): number(0) {}
+
+    explicit operator uint64_t() const {
+        return reduce(number);
+    }
+
+    Residue64<N>& operator=(long long x) {
+        return *this = Residue64<N>(x);
+    }
+
+    Residue64<N>& operator=(const Residue64<N>& x) = default;
+
+    Residue64<N>& operator+=(const Residue64<N>& x) {
+        uint64_t sum = number + x.number;
+        if (sum < number || sum >= N)
+            sum -= N;
+        number = sum;
+        return *this;
+    }
+
+    Residue64<N> operator+(const Residue64<N>& x) const {
+        Residue64<N> a = *this;
+        a += x;
+        return a;
+    }
+
+    Residue64<N> operator-() const {
+        Residue64<N> a;
+        a -= *this;
+        return a;
+    }
+
+    Residue64<N>& operator-=(const Residue64<N>& x) {
+        if (number < x.number)
+            number += N;
+        number -= x.number;
+        return *this;
+    }
+
+    Residue64<N> operator-(const Residue64<N>& x) const {
+        Residue64<N> a = *this;
+        a -= x;
+        return a;
+    }
+
+    Residue64<N>& operator*=(const Residue64<N>& x) {
+        number = multiply(number, x.number);
+        return *this;
+    }
+
+    Residue64<N> operator*(const Residue64<N>& x) const {
+        Residue64<N> a = *this;
+        a *= x;
+        return a;
+    }
+
+    bool operator==(const Residue64<N>& x) const {
+        return number == x.number;
+    }
+
+    bool operator!=(const Residue64<N>& x) const {
+        return number != x.number;
+    }
+
+    Residue64<N> pow(uint64_t k) const {
+        Residue64<N> result(1);
+        Residue64<N> base = *this;
+        for (; k > 0; k >>= 1) {
+            if (k & 1)
+                result *= base;
+            base *= base;
+        }
+        return result;
+    }
+
+    bool isInvertible() const {
+        return gcd64(number, N) == 1;
+    }
+
+    // Any N; asserts that the element is invertible.
+    Residue64<N> getInverse() const {
+        Residue64<N> result;
+        result.number = binaryInverse(number);
+        assert(N == 1 || result.number != 0);
+        return result;
+    }
+
+    Residue64<N>& operator/=(const Residue64<N>& x) {
+        Residue64<N> inv_x = x.getInverse();
+        return *this *= inv_x;
+    }
+
+    Residue64<N> operator/(const Residue64<N>& x) const {
+        Residue64<N> a = *this;
+        a /= x;
+        return a;
+    }
+
+    uint64_t order() const {
+        if (number == 0 || EF == 0 || !isInvertible())
+            return 0;
+        const Residue64<N> one(1);
+        if (*this == one)
+            return 1;
+
+        constexpr prime_factorization64 f = factorize64(EF);
+        uint64_t ans = EF;
+        for (unsigned i = 0; i < f.count; ++i) {
+            for (unsigned k = 0; k < f.powers[i]; ++k) {
+                if (pow(ans / f.primes[i]) != one)
+                    break;
+                ans /= f.primes[i];
+            }
+        }
+        assert(pow(ans) == one);
+        return ans;
+    }
+
+    static Residue64<N> getPrimitiveRoot() {
+        compilation_error<has_primitive_root_number64(N)> a;
+        a = a;
+
+        constexpr uint64_t root = primitive_root64(N);
+        Residue64<N> result;
+        result.number = multiply(root, r2);
+        return result;
+    }
+};
+
+template <uint64_t N>
+bool operator==(const Residue64<N>& a, int b) {
+    return a == Residue64<N>(b);
+}
+
+template <uint64_t N>
+bool operator!=(const Residue64<N>& a, int b) {
+    return a != Residue64<N>(b);
+}
+
+template <uint64_t N>
+std::istream& operator>>(std::istream& in, Residue64<N>& i) {
+    long long a;
+    in >> a;
+    i = a;
+    return in;
+}
+
+#endif // RESIDUE_H_RESIDUE64_H_
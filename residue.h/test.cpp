@@ -0,0 +1,6 @@
+#include "test_residue.h"
+
+int main() {
+    testingFunction();
+    return 0;
+}
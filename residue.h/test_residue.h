@@ -0,0 +1,755 @@
+#ifndef RESIDUE_H__TEST_RESIDUE_H_
+#define RESIDUE_H__TEST_RESIDUE_H_
+
+#include "residue.h"
+#include <cassert>
+#include <climits>
+#include <random>
+#include <thread>
+
+// Reference implementations work on plain integers, independent of every kernel under test.
+unsigned long long naive_pow_mod(unsigned long long x, unsigned long long k, unsigned long long n) {
+    unsigned long long result = 1 % n;
+    for (unsigned long long i = 0; i < k; ++i) {
+        result = static_cast<unsigned long long>(static_cast<unsigned __int128>(result) * x % n);
+    }
+    return result;
+}
+
+unsigned long long square_and_multiply(unsigned long long x, unsigned long long k, unsigned long long n) {
+    unsigned long long result = 1 % n;
+    for (x %= n; k > 0; k >>= 1) {
+        if (k & 1)
+            result = static_cast<unsigned long long>(static_cast<unsigned __int128>(result) * x % n);
+        x = static_cast<unsigned long long>(static_cast<unsigned __int128>(x) * x % n);
+    }
+    return result;
+}
+
+unsigned long long square_and_multiply_128(unsigned __int128 x, unsigned long long k, unsigned long long n) {
+    unsigned __int128 result = 1 % n;
+    for (x %= n; k > 0; k >>= 1) {
+        if (k & 1)
+            result = result * x % n;
+        x = x * x % n;
+    }
+    return static_cast<unsigned long long>(result);
+}
+
+unsigned long long naive_inverse(unsigned long long x, unsigned long long n) {
+    for (unsigned long long y = 1; y < n; ++y) {
+        if (static_cast<unsigned __int128>(x) * y % n == 1)
+            return y;
+    }
+    return 0;
+}
+
+// int conversion wraps for residues above INT_MAX
+template<unsigned N>
+unsigned long long value(const Residue<N>& x) {
+    return static_cast<unsigned>(static_cast<int>(x));
+}
+
+bool naive_is_prime(unsigned long long n) {
+    if (n < 2)
+        return false;
+    for (unsigned long long d = 2; d * d <= n; ++d) {
+        if (n % d == 0)
+            return false;
+    }
+    return true;
+}
+
+unsigned naive_euler_function(unsigned n) {
+    unsigned count = 0;
+    for (unsigned x = 1; x <= n; ++x) {
+        count += std::gcd(x, n) == 1;
+    }
+    return count;
+}
+
+// smallest k > 0 with x^k = 1 (mod n), 0 for non-units
+unsigned naive_order(unsigned x, unsigned n) {
+    if (std::gcd(x, n) != 1)
+        return 0;
+    unsigned long long power = x % n;
+    for (unsigned k = 1; k <= n; ++k) {
+        if (power == 1 % n)
+            return k;
+        power = power * x % n;
+    }
+    return 0;
+}
+
+template<unsigned N>
+std::vector<Residue<N>> random_residues(std::mt19937& rnd, size_t n) {
+    std::vector<Residue<N>> a(n);
+    for (size_t i = 0; i < n; ++i) {
+        a[i] = Residue<N>(static_cast<int>(rnd() % std::min(N, 1u << 31)));
+    }
+    return a;
+}
+
+template<unsigned N>
+void batchTest(std::mt19937& rnd) {
+    // 8 lanes plus a tail, so both the vector and the scalar loops run
+    const size_t n = 37;
+    std::vector<Residue<N>> a = random_residues<N>(rnd, n);
+    std::vector<Residue<N>> b = random_residues<N>(rnd, n);
+    a[3] = Residue<N>(0);
+    a[17] = Residue<N>(0);
+    Residue<N> alpha = random_residues<N>(rnd, 1)[0];
+
+    std::vector<Residue<N>> result(n);
+    mul_n(result.data(), a.data(), b.data(), n);
+    for (size_t i = 0; i < n; ++i) {
+        assert(value(result[i]) == value(a[i]) * value(b[i]) % N);
+    }
+    add_n(result.data(), a.data(), b.data(), n);
+    for (size_t i = 0; i < n; ++i) {
+        assert(value(result[i]) == (value(a[i]) + value(b[i])) % N);
+    }
+    std::vector<Residue<N>> y = b;
+    axpy_n(y.data(), alpha, a.data(), n);
+    for (size_t i = 0; i < n; ++i) {
+        assert(value(y[i]) == (value(b[i]) + value(alpha) * value(a[i]) % N) % N);
+    }
+    pow_n(result.data(), a.data(), 13, n);
+    for (size_t i = 0; i < n; ++i) {
+        assert(value(result[i]) == naive_pow_mod(value(a[i]), 13, N));
+    }
+}
+
+template<unsigned N>
+void batchInverseTest(std::mt19937& rnd) {
+    const size_t n = 29;
+    std::vector<Residue<N>> a = random_residues<N>(rnd, n);
+    a[0] = Residue<N>(0);
+    a[11] = Residue<N>(0);
+    a[n - 1] = Residue<N>(0);
+
+    // a separate output buffer full of garbage: every slot, zeros included, is written
+    std::vector<Residue<N>> result(n, Residue<N>(7));
+    batch_inverse(result.data(), a.data(), n);
+    for (size_t i = 0; i < n; ++i) {
+        if (value(a[i]) == 0)
+            assert(value(result[i]) == 0);
+        else
+            assert(value(result[i]) == naive_inverse(value(a[i]), N));
+    }
+
+    std::vector<Residue<N>> in_place = a;
+    batch_inverse(in_place.data(), in_place.data(), n);
+    for (size_t i = 0; i < n; ++i) {
+        assert(value(in_place[i]) == value(result[i]));
+    }
+}
+
+void batchArithmeticTest() {
+    std::cout << "Batch arithmetic tests: \n";
+    std::mt19937 rnd(45);
+
+    batchTest<998244353>(rnd);
+    batchTest<1000000007>(rnd);
+    batchTest<4294967291u>(rnd);
+    std::cout << "Ok! mul_n, add_n, axpy_n and pow_n match the scalar definition\n";
+
+    batchInverseTest<10007>(rnd);
+    batchInverseTest<65537>(rnd);
+    std::cout << "Ok! batch_inverse writes every slot, zeros map to zero\n";
+}
+
+void numberTheoryTest() {
+    std::cout << "Number theory tests: \n";
+
+    static_assert(is_prime_v<998244353> && !is_prime_v<998244351>, "primality at compile time");
+    static_assert(euler_function(1000000007) == 1000000006, "totient at compile time");
+    static_assert(primitive_root(998244353) == 3, "primitive root at compile time");
+    static_assert(!has_primitive_root_v<8> && has_primitive_root_v<50>, "cyclic groups at compile time");
+
+    for (unsigned n = 0; n < 3000; ++n) {
+        assert(is_prime_number(n) == naive_is_prime(n));
+    }
+    std::mt19937 rnd(42);
+    for (int t = 0; t < 2000; ++t) {
+        unsigned n = rnd() | 1;
+        assert(is_prime_number(n) == naive_is_prime(n));
+    }
+    // strong pseudoprimes to small bases and the largest 32-bit prime
+    for (unsigned n : {2047u, 3215031751u, 4294967291u, 4294967295u, 4294967279u}) {
+        assert(is_prime_number(n) == naive_is_prime(n));
+    }
+    std::cout << "Ok! is_prime_number matches trial division\n";
+
+    for (unsigned n = 1; n < 2000; ++n) {
+        prime_factorization f = factorize(n);
+        unsigned long long product = 1;
+        for (unsigned i = 0; i < f.count; ++i) {
+            assert(naive_is_prime(f.primes[i]) && (i == 0 || f.primes[i - 1] < f.primes[i]));
+            for (unsigned k = 0; k < f.powers[i]; ++k) {
+                product *= f.primes[i];
+            }
+        }
+        assert(product == n);
+        assert(euler_function(n) == naive_euler_function(n));
+    }
+    std::cout << "Ok! factorize and euler_function match the definitions\n";
+
+    for (unsigned n = 2; n < 600; ++n) {
+        unsigned phi = naive_euler_function(n);
+        unsigned smallest_root = 0;
+        for (unsigned g = 1; g < n && smallest_root == 0; ++g) {
+            if (naive_order(g, n) == phi)
+                smallest_root = g;
+        }
+        assert(has_primitive_root_number(n) == (smallest_root != 0));
+        assert(primitive_root(n) == smallest_root);
+    }
+    std::cout << "Ok! primitive_root is the smallest generator, when there is one\n";
+}
+
+template<unsigned N>
+void orderTest() {
+    for (unsigned x = 0; x < N; ++x) {
+        assert(Residue<N>(x).order() == naive_order(x, N));
+    }
+}
+
+void multiplicativeOrderTest() {
+    std::cout << "Order tests: \n";
+
+    orderTest<997>();
+    orderTest<1000>();
+    orderTest<1024>();
+    orderTest<486>();
+    orderTest<2>();
+    std::cout << "Ok! order matches the smallest k with x^k = 1\n";
+
+    // too large to count: x^order = 1 and x^(order / p) != 1 for every prime p | order
+    const unsigned P = 2147483647;
+    std::mt19937 rnd(43);
+    for (int t = 0; t < 200; ++t) {
+        unsigned x = 1 + rnd() % (P - 1);
+        unsigned k = Residue<P>(x).order();
+        assert(square_and_multiply(x, k, P) == 1);
+        assert((P - 1) % k == 0);
+        prime_factorization f = factorize(k);
+        for (unsigned i = 0; i < f.count; ++i) {
+            assert(square_and_multiply(x, k / f.primes[i], P) != 1);
+        }
+    }
+    assert(Residue<P>::getPrimitiveRoot().order() == P - 1);
+    std::cout << "Ok! order is exact for random elements of a large prime field\n";
+}
+
+// DynamicResidue under a context for N must behave exactly like Residue<N>
+template<unsigned N>
+void dynamicResidueTest(std::mt19937& rnd) {
+    ModContext context(N);
+    ModContext::Scope scope(context);
+    for (int t = 0; t < 2000; ++t) {
+        int x = static_cast<int>(rnd() % (2 * N)) - static_cast<int>(N);
+        int y = static_cast<int>(rnd() % N);
+        Residue<N> a(x);
+        Residue<N> b(y);
+        DynamicResidue da(x);
+        DynamicResidue db(y);
+        assert(static_cast<int>(da) == static_cast<int>(a));
+        assert(static_cast<int>(da + db) == static_cast<int>(a + b));
+        assert(static_cast<int>(da - db) == static_cast<int>(a - b));
+        assert(static_cast<int>(-da) == static_cast<int>(Residue<N>() - a));
+        assert(static_cast<int>(da * db) == static_cast<int>(a * b));
+        assert(static_cast<int>(da.pow(y)) == static_cast<int>(a.pow(y)));
+        assert(da.order() == a.order());
+        assert(db.isInvertible() == b.isInvertible());
+        if (b.isInvertible())
+            assert(static_cast<int>(da / db) == static_cast<int>(a / b));
+    }
+}
+
+void dynamicResidueTests() {
+    std::cout << "DynamicResidue tests: \n";
+    std::mt19937 rnd(44);
+
+    dynamicResidueTest<1000000007>(rnd);
+    dynamicResidueTest<10007>(rnd);
+    dynamicResidueTest<1000000>(rnd);
+    dynamicResidueTest<999999999>(rnd);
+    dynamicResidueTest<2>(rnd);
+    dynamicResidueTest<1>(rnd);
+    {
+        ModContext context(1000000007);
+        ModContext::Scope scope(context);
+        assert(static_cast<int>(DynamicResidue::getPrimitiveRoot()) ==
+               static_cast<int>(Residue<1000000007>::getPrimitiveRoot()));
+    }
+    std::cout << "Ok! Montgomery and Barrett contexts agree with Residue<N>\n";
+
+    ModContext outer_context(17);
+    ModContext inner_context(19);
+    ModContext::Scope outer(outer_context);
+    {
+        ModContext::Scope inner(inner_context);
+        assert(ModContext::current().modulus() == 19);
+        assert(DynamicResidue(20) == 1);
+    }
+    assert(ModContext::current().modulus() == 17);
+    assert(DynamicResidue(20) == 3);
+
+    // the current context is per thread
+    unsigned seen = 0;
+    std::thread other([&seen]() {
+        assert(!ModContext::hasCurrent());
+        ModContext context(23);
+        ModContext::Scope scope(context);
+        seen = ModContext::current().modulus();
+    });
+    other.join();
+    assert(seen == 23 && ModContext::current().modulus() == 17);
+    std::cout << "Ok! Scopes nest and every thread has its own context\n";
+}
+
+// schoolbook product on raw values
+template<unsigned P>
+std::vector<unsigned long long> naive_product(const Polynomial<Residue<P>>& a, const Polynomial<Residue<P>>& b) {
+    if (a.size() == 0 || b.size() == 0)
+        return std::vector<unsigned long long>();
+    std::vector<unsigned long long> c(a.size() + b.size() - 1);
+    for (size_t i = 0; i < a.size(); ++i) {
+        for (size_t j = 0; j < b.size(); ++j) {
+            c[i + j] = (c[i + j] + value(a[i]) * value(b[j])) % P;
+        }
+    }
+    while (!c.empty() && c.back() == 0) {
+        c.pop_back();
+    }
+    return c;
+}
+
+template<unsigned P>
+std::vector<unsigned long long> raw_coefficients(const Polynomial<Residue<P>>& a) {
+    std::vector<unsigned long long> c(a.size());
+    for (size_t i = 0; i < a.size(); ++i) {
+        c[i] = value(a[i]);
+    }
+    return c;
+}
+
+template<unsigned P>
+Polynomial<Residue<P>> random_polynomial(std::mt19937& rnd, size_t n) {
+    return Polynomial<Residue<P>>(random_residues<P>(rnd, n));
+}
+
+// O(n^2) power series references: g = 1 / a, g = log a and g = exp a by their recurrences;
+// inverses by Fermat, P is prime
+template<unsigned P>
+Residue<P> fermat_inverse(unsigned long long x) {
+    return Residue<P>(static_cast<int>(square_and_multiply(x, P - 2, P)));
+}
+
+template<unsigned P>
+std::vector<Residue<P>> naive_series_inverse(const Polynomial<Residue<P>>& a, size_t n) {
+    std::vector<Residue<P>> g(n);
+    Residue<P> inverse_a0 = fermat_inverse<P>(value(a[0]));
+    g[0] = inverse_a0;
+    for (size_t k = 1; k < n; ++k) {
+        Residue<P> sum(0);
+        for (size_t j = 1; j <= k; ++j) {
+            sum += a[j] * g[k - j];
+        }
+        g[k] = Residue<P>(0) - sum * inverse_a0;
+    }
+    return g;
+}
+
+template<unsigned P>
+std::vector<Residue<P>> naive_series_log(const Polynomial<Residue<P>>& a, size_t n) {
+    // k g_k = k a_k - sum_{j < k} j g_j a_(k - j)
+    std::vector<Residue<P>> g(n);
+    for (size_t k = 1; k < n; ++k) {
+        Residue<P> sum = a[k] * Residue<P>(static_cast<int>(k));
+        for (size_t j = 1; j < k; ++j) {
+            sum -= Residue<P>(static_cast<int>(j)) * g[j] * a[k - j];
+        }
+        g[k] = sum * fermat_inverse<P>(k);
+    }
+    return g;
+}
+
+template<unsigned P>
+std::vector<Residue<P>> naive_series_exp(const Polynomial<Residue<P>>& a, size_t n) {
+    // k g_k = sum_{j <= k} j a_j g_(k - j)
+    std::vector<Residue<P>> g(n);
+    g[0] = Residue<P>(1);
+    for (size_t k = 1; k < n; ++k) {
+        Residue<P> sum(0);
+        for (size_t j = 1; j <= k; ++j) {
+            sum += Residue<P>(static_cast<int>(j)) * a[j] * g[k - j];
+        }
+        g[k] = sum * fermat_inverse<P>(k);
+    }
+    return g;
+}
+
+template<unsigned P>
+void polynomialProductTest(std::mt19937& rnd) {
+    for (size_t n : {1, 5, 33, 100, 1000}) {
+        Polynomial<Residue<P>> a = random_polynomial<P>(rnd, n);
+        Polynomial<Residue<P>> b = random_polynomial<P>(rnd, n + 7);
+        assert(raw_coefficients(a * b) == naive_product(a, b));
+    }
+    // all coefficients P - 1: the CRT path must not overflow its three primes
+    std::vector<Residue<P>> worst(700, Residue<P>(-1));
+    Polynomial<Residue<P>> w(worst);
+    assert(raw_coefficients(w * w) == naive_product(w, w));
+    assert((Polynomial<Residue<P>>() * w).size() == 0);
+}
+
+template<unsigned P>
+void polynomialDivisionTest(std::mt19937& rnd) {
+    for (size_t m : {1, 20, 33, 200}) {
+        Polynomial<Residue<P>> a = random_polynomial<P>(rnd, 500);
+        Polynomial<Residue<P>> b = random_polynomial<P>(rnd, m);
+        Polynomial<Residue<P>> q = a / b;
+        Polynomial<Residue<P>> r = a % b;
+        assert(r.degree() < b.degree() || b.degree() == 0);
+        assert(q * b + r == a);
+    }
+    Polynomial<Residue<P>> small = {1, 2};
+    assert((small / Polynomial<Residue<P>>{1, 2, 3}).size() == 0);
+}
+
+template<unsigned P>
+void powerSeriesTest(std::mt19937& rnd) {
+    const size_t n = 300;
+    Polynomial<Residue<P>> a = random_polynomial<P>(rnd, n);
+    if (value(a[0]) == 0)
+        a = a + Polynomial<Residue<P>>{1};
+    assert(a.inverse(n) == Polynomial<Residue<P>>(naive_series_inverse(a, n)));
+    assert((a * a.inverse(n)).truncated(n) == Polynomial<Residue<P>>{1});
+
+    Polynomial<Residue<P>> one_plus = (a - Polynomial<Residue<P>>{static_cast<int>(value(a[0]))}) + Polynomial<Residue<P>>{1};
+    Polynomial<Residue<P>> log = one_plus.log(n);
+    assert(log == Polynomial<Residue<P>>(naive_series_log(one_plus, n)));
+
+    Polynomial<Residue<P>> f = one_plus - Polynomial<Residue<P>>{1};
+    Polynomial<Residue<P>> exp = f.exp(n);
+    assert(exp == Polynomial<Residue<P>>(naive_series_exp(f, n)));
+    assert(exp.log(n) == f.truncated(n));
+    assert(log.exp(n) == one_plus.truncated(n));
+}
+
+void polynomialTest() {
+    std::cout << "Polynomial tests: \n";
+    std::mt19937 rnd(46);
+
+    polynomialProductTest<998244353>(rnd);
+    polynomialProductTest<7340033>(rnd);
+    polynomialProductTest<1000000007>(rnd);
+    polynomialProductTest<1000000>(rnd);
+    std::cout << "Ok! NTT, three-prime CRT and schoolbook products agree\n";
+
+    polynomialDivisionTest<998244353>(rnd);
+    polynomialDivisionTest<1000000007>(rnd);
+    std::cout << "Ok! a = (a / b) b + a % b with deg(a % b) < deg b\n";
+
+    powerSeriesTest<998244353>(rnd);
+    powerSeriesTest<1000000007>(rnd);
+    std::cout << "Ok! inverse, log and exp match their power series recurrences\n";
+
+    // threads that build the root tables of a fresh prime at the same time
+    std::vector<Polynomial<Residue<754974721>>> a, b;
+    for (size_t n : {300, 700, 1500, 3000}) {
+        a.push_back(random_polynomial<754974721>(rnd, n));
+        b.push_back(random_polynomial<754974721>(rnd, n + 11));
+    }
+    std::vector<std::vector<unsigned long long>> products(a.size());
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < a.size(); ++i) {
+        threads.emplace_back([&, i]() {
+            products[i] = raw_coefficients(a[i] * b[i]);
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    for (size_t i = 0; i < a.size(); ++i) {
+        assert(products[i] == naive_product(a[i], b[i]));
+    }
+    std::cout << "Ok! Products in several threads share the root tables\n";
+}
+
+template<unsigned P>
+void squareRootTest() {
+    std::vector<bool> square(P, false);
+    for (unsigned long long y = 0; y < P; ++y) {
+        square[y * y % P] = true;
+    }
+    for (unsigned x = 0; x < P; ++x) {
+        Residue<P> a(static_cast<int>(x));
+        assert(a.isSquare() == square[x]);
+        if (!square[x])
+            continue;
+        unsigned long long root = value(a.sqrt());
+        assert(root * root % P == x && root <= (P - root) % P);
+    }
+}
+
+// smallest k >= 0 with base^k = x by walking the powers, -1 when there is none
+template<unsigned N>
+long long naive_log(unsigned x, unsigned base) {
+    unsigned long long power = 1 % N;
+    for (unsigned k = 0; k <= N; ++k) {
+        if (power == x)
+            return k;
+        power = power * base % N;
+    }
+    return -1;
+}
+
+template<unsigned N>
+void discreteLogTest(std::mt19937& rnd) {
+    for (int t = 0; t < 300; ++t) {
+        unsigned x = rnd() % N;
+        unsigned base = rnd() % N;
+        if (t % 2 == 0)
+            x = square_and_multiply(base, rnd() % N, N);
+        long long expected = std::gcd(x, N) != 1 || std::gcd(base, N) != 1 ? -1 : naive_log<N>(x, base);
+        assert(Residue<N>(static_cast<int>(x)).log(Residue<N>(static_cast<int>(base))) == expected);
+    }
+}
+
+void squareRootAndLogTest() {
+    std::cout << "Square root and logarithm tests: \n";
+    std::mt19937 rnd(47);
+
+    squareRootTest<2>();
+    squareRootTest<3>();
+    squareRootTest<10007>();
+    // 65537 - 1 = 2^16: the longest Tonelli-Shanks loop
+    squareRootTest<65537>();
+    const unsigned P = 998244353;
+    for (int t = 0; t < 1000; ++t) {
+        unsigned long long y = rnd() % P;
+        unsigned long long root = value(Residue<P>(static_cast<int>(y * y % P)).sqrt());
+        assert(root == std::min(y, (P - y) % P));
+    }
+    std::cout << "Ok! isSquare and sqrt match the table of squares\n";
+
+    discreteLogTest<10007>(rnd);
+    discreteLogTest<65537>(rnd);
+    // composite moduli with a primitive root: 3^7 and 2 * 3^7
+    discreteLogTest<2187>(rnd);
+    discreteLogTest<4374>(rnd);
+    for (int t = 0; t < 200; ++t) {
+        Residue<P> base(static_cast<int>(1 + rnd() % (P - 1)));
+        unsigned k = rnd();
+        assert(base.pow(k).log(base) == k % base.order());
+    }
+    std::cout << "Ok! log is the smallest exponent, -1 when there is none\n";
+}
+
+template<unsigned N>
+void inverseTest() {
+    for (unsigned x = 0; x < N; ++x) {
+        Residue<N> a(static_cast<int>(x));
+        assert(a.isInvertible() == (std::gcd(x, N) == 1));
+        if (a.isInvertible())
+            assert(value(a.getInverse()) == naive_inverse(x, N) % N);
+    }
+}
+
+template<unsigned N>
+void largeInverseTest(std::mt19937& rnd) {
+    for (int t = 0; t < 10000; ++t) {
+        Residue<N> a = random_residues<N>(rnd, 1)[0];
+        if (!a.isInvertible())
+            continue;
+        assert(value(a) * value(a.getInverse()) % N == 1);
+    }
+}
+
+void compositeInverseTest() {
+    std::cout << "Inverse tests: \n";
+    std::mt19937 rnd(48);
+
+    inverseTest<1>();
+    inverseTest<2>();
+    inverseTest<999>();
+    inverseTest<1000>();
+    inverseTest<1024>();
+    inverseTest<10007>();
+    std::cout << "Ok! getInverse matches brute force for odd, even and prime moduli\n";
+
+    largeInverseTest<2147483647>(rnd);
+    largeInverseTest<1000000000>(rnd);
+    largeInverseTest<4294967291u>(rnd);
+    largeInverseTest<4294967295u>(rnd);
+    std::cout << "Ok! getInverse is exact for moduli up to 2^32 - 1\n";
+}
+
+template<uint64_t N>
+void residue64Test(std::mt19937_64& rnd) {
+    typedef unsigned __int128 u128;
+    for (int t = 0; t < 20000; ++t) {
+        long long x = static_cast<long long>(rnd());
+        long long y = static_cast<long long>(rnd() >> 1);
+        u128 rx = (x < 0 ? 0 - static_cast<uint64_t>(x) : static_cast<uint64_t>(x)) % N;
+        if (x < 0)
+            rx = (N - rx) % N;
+        u128 ry = static_cast<u128>(y) % N;
+        Residue64<N> a(x);
+        Residue64<N> b(y);
+        assert(static_cast<uint64_t>(a) == rx);
+        assert(static_cast<uint64_t>(a + b) == (rx + ry) % N);
+        assert(static_cast<uint64_t>(a - b) == (rx + N - ry) % N);
+        assert(static_cast<uint64_t>(-a) == (N - rx) % N);
+        assert(static_cast<uint64_t>(a * b) == rx * ry % N);
+        if (t % 20 == 0) {
+            unsigned k = static_cast<unsigned>(rnd() % 100000);
+            assert(static_cast<uint64_t>(a.pow(k)) == square_and_multiply_128(rx, k, N));
+        }
+        if (a.isInvertible())
+            assert(static_cast<uint64_t>(a.getInverse()) * rx % N == 1 % N);
+        else
+            assert(std::gcd(static_cast<uint64_t>(rx), N) != 1);
+    }
+}
+
+void residue64Tests() {
+    std::cout << "Residue64 tests: \n";
+    std::mt19937_64 rnd(49);
+
+    residue64Test<1000003>(rnd);
+    residue64Test<(1ULL << 61) - 1>(rnd);
+    residue64Test<18446744073709551557ULL>(rnd);
+    // 3 * 5 * 17 * 257 * 641 * 65537 * 6700417
+    residue64Test<18446744073709551615ULL>(rnd);
+    std::cout << "Ok! Montgomery arithmetic matches 128-bit reduction up to 2^64 - 1\n";
+
+    const uint64_t Q = 18446744073709551557ULL;
+    for (int t = 0; t < 20; ++t) {
+        Residue64<Q> a(static_cast<long long>(rnd() >> 1));
+        uint64_t k = a.order();
+        assert((Q - 1) % k == 0);
+        assert(a.pow(k) == 1);
+        prime_factorization64 f = factorize64(k);
+        for (unsigned i = 0; i < f.count; ++i) {
+            assert(a.pow(k / f.primes[i]) != 1);
+        }
+    }
+    assert(Residue64<Q>::getPrimitiveRoot().order() == Q - 1);
+    std::cout << "Ok! order and the primitive root are exact for the largest 64-bit prime\n";
+}
+
+// any v < N; values above INT_MAX are reached as 0 - (N - v), so none passes through int
+template<unsigned N>
+Residue<N> residue_of(unsigned long long v) {
+    if (v <= INT_MAX)
+        return Residue<N>(static_cast<int>(v));
+    return Residue<N>(0) - Residue<N>(static_cast<int>(N - v));
+}
+
+template<unsigned N>
+void additionTest(std::mt19937& rnd) {
+    const long long n = N;
+    std::vector<int> inputs = {0, 1, -1, INT_MAX, INT_MIN, INT_MIN + 1};
+    for (long long x : {n - 1, n, n + 1, -n + 1, -n, -n - 1}) {
+        if (x >= INT_MIN && x <= INT_MAX)
+            inputs.push_back(static_cast<int>(x));
+    }
+    for (int t = 0; t < 1000; ++t) {
+        inputs.push_back(static_cast<int>(rnd()));
+    }
+    for (int x : inputs) {
+        assert(value(Residue<N>(x)) == static_cast<unsigned long long>((x % n + n) % n));
+    }
+
+    // operands up to N - 1, above INT_MAX for the large moduli
+    std::vector<unsigned long long> values = {0, 1, N - 1ULL, N - 2ULL, N / 2, N / 2 + 1ULL};
+    for (int t = 0; t < 200; ++t) {
+        values.push_back(rnd() % N);
+    }
+    for (unsigned long long x : values) {
+        for (unsigned long long y : values) {
+            Residue<N> a = residue_of<N>(x % N);
+            Residue<N> b = residue_of<N>(y % N);
+            assert(value(a) == x % N && value(b) == y % N);
+            assert(value(a + b) == (x % N + y % N) % N);
+            assert(value(a - b) == (x % N + N - y % N) % N);
+            Residue<N> c = a;
+            c += b;
+            c -= b;
+            assert(value(c) == value(a));
+        }
+    }
+}
+
+void additionTests() {
+    std::cout << "Addition tests: \n";
+    std::mt19937 rnd(50);
+
+    additionTest<1>(rnd);
+    additionTest<2>(rnd);
+    additionTest<1000000007>(rnd);
+    additionTest<2147483647>(rnd);
+    additionTest<2147483659u>(rnd);
+    additionTest<4294967291u>(rnd);
+    additionTest<4294967295u>(rnd);
+    std::cout << "Ok! Construction, + and - reduce correctly up to N = 2^32 - 1\n";
+}
+
+template<unsigned N>
+void reductionTest(std::mt19937& rnd) {
+    // the extremes make products near N^2, above 2^63 for the large moduli
+    std::vector<unsigned long long> values = {0, 1, 2, N - 1ULL, N - 2ULL, N / 2, N / 2 + 1ULL};
+    for (int t = 0; t < 100; ++t) {
+        values.push_back(rnd() % N);
+    }
+    for (unsigned long long x : values) {
+        Residue<N> a = residue_of<N>(x % N);
+        for (unsigned long long y : values) {
+            Residue<N> b = residue_of<N>(y % N);
+            assert(value(a * b) == x % N * (y % N) % N);
+        }
+        unsigned k = rnd();
+        assert(value(a.pow(k)) == square_and_multiply(x, k, N));
+        unsigned order = a.order();
+        if (order != 0) {
+            assert(square_and_multiply(x, order, N) == 1 % N);
+            assert(euler_function(N) % order == 0);
+        }
+    }
+}
+
+void reductionTests() {
+    std::cout << "Reduction tests: \n";
+    std::mt19937 rnd(41);
+
+    // Montgomery form for the odd moduli, Barrett reduction for the even ones
+    reductionTest<1>(rnd);
+    reductionTest<2>(rnd);
+    reductionTest<999>(rnd);
+    reductionTest<1000>(rnd);
+    reductionTest<998244353>(rnd);
+    reductionTest<1000000006>(rnd);
+    reductionTest<2147483647>(rnd);
+    reductionTest<4294967291u>(rnd);
+    reductionTest<4294967294u>(rnd);
+    std::cout << "Ok! *, pow and order match plain arithmetic for odd and even moduli\n";
+}
+
+void testingFunction() {
+    numberTheoryTest();
+    multiplicativeOrderTest();
+    dynamicResidueTests();
+    batchArithmeticTest();
+    polynomialTest();
+    squareRootAndLogTest();
+    compositeInverseTest();
+    residue64Tests();
+    additionTests();
+    reductionTests();
+}
+
+#endif //RESIDUE_H__TEST_RESIDUE_H_